@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "trace.h"
+#include "view.h"
+#include "braille.h"
+
+// Bit de cada ponto no caracter braille, [linha][coluna]
+static const unsigned char DOT[BRAILLE_DOTS_H][BRAILLE_DOTS_W] = {
+    {0x01, 0x08},
+    {0x02, 0x10},
+    {0x04, 0x20},
+    {0x40, 0x80},
+};
+
+// Caracter ASCII por quadrante: bit 0 = cima esq, 1 = cima dir,
+// 2 = baixo esq, 3 = baixo dir
+static const char QUADRANT[16] = {
+    ' ', '\'', '`', '"', ',', '|', '/', 'F',
+    '.', '\\', '|', '7', '_', 'L', 'J', '#',
+};
+
+struct BrailleCanvas *create_braille(int width, int height, int x, int y){
+    struct BrailleCanvas *c;
+    if (width <= 0 || height <= 0)
+        return NULL;
+    if ((c = calloc(1, sizeof(struct BrailleCanvas))) == NULL)
+        return NULL;
+
+    c->width = width;
+    c->height = height;
+    c->x = x;
+    c->y = y;
+    c->dot_w = width * BRAILLE_DOTS_W;
+    c->dot_h = height * BRAILLE_DOTS_H;
+    c->words_per_row = (width + 63) / 64;
+    c->cells = calloc((size_t)width * height, sizeof(unsigned char));
+    c->shown = calloc((size_t)width * height, sizeof(unsigned char));
+    c->dirty = calloc((size_t)c->words_per_row * height, sizeof(uint64_t));
+    if (c->cells == NULL || c->shown == NULL || c->dirty == NULL)
+        return destroy_braille(c);
+    // o canvas comeca todo sujo para o primeiro render desenhar tudo
+    braille_invalidate(c);
+
+    return c;
+}
+
+void braille_invalidate(struct BrailleCanvas *c){
+    if (c == NULL)
+        return;
+    for (int cy = 0; cy < c->height; cy++)
+        for (int cx = 0; cx < c->width; cx++)
+            c->dirty[cy * c->words_per_row + cx / 64] |= 1ull << (cx % 64);
+    c->row_dirty_min = 0;
+    c->row_dirty_max = c->height - 1;
+    c->redraw = 1;
+}
+
+struct BrailleCanvas *destroy_braille(struct BrailleCanvas *c){
+    if (c == NULL)
+        return NULL;
+    free(c->cells);
+    free(c->shown);
+    free(c->dirty);
+    free(c);
+
+    return NULL;
+}
+
+static void mark_dirty(struct BrailleCanvas *c, int cx, int cy){
+    c->dirty[cy * c->words_per_row + cx / 64] |= 1ull << (cx % 64);
+    if (cy < c->row_dirty_min)
+        c->row_dirty_min = cy;
+    if (cy > c->row_dirty_max)
+        c->row_dirty_max = cy;
+}
+
+void braille_clear(struct BrailleCanvas *c){
+    unsigned char *row;
+    uint64_t chunk;
+    int cx;
+    if (c == NULL)
+        return;
+    // so os cells que tinham pontos mudam, 8 cells vazios por teste
+    for (int cy = 0; cy < c->height; cy++){
+        row = &c->cells[cy * c->width];
+        for (cx = 0; cx + 8 <= c->width; cx += 8){
+            memcpy(&chunk, row + cx, sizeof(chunk));
+            if (chunk == 0)
+                continue;
+            for (int i = cx; i < cx + 8; i++)
+                if (row[i] != 0)
+                    mark_dirty(c, i, cy);
+        }
+        for (; cx < c->width; cx++)
+            if (row[cx] != 0)
+                mark_dirty(c, cx, cy);
+    }
+    memset(c->cells, 0, (size_t)c->width * c->height);
+}
+
+// Pontos de um cell nas colunas [cx0, cx1] e linhas [ry0, ry1]
+static unsigned char cell_mask(int cx0, int cx1, int ry0, int ry1){
+    unsigned char m = 0;
+    if (cx0 == 0 && cx1 == BRAILLE_DOTS_W - 1 && ry0 == 0 && ry1 == BRAILLE_DOTS_H - 1)
+        return 0xff;
+    for (int r = ry0; r <= ry1; r++)
+        for (int col = cx0; col <= cx1; col++)
+            m |= DOT[r][col];
+    return m;
+}
+
+// Aplica a mascara no cell e marca dirty se mudou
+static void or_cell(struct BrailleCanvas *c, int cx, int cy, unsigned char m){
+    unsigned char *v = &c->cells[cy * c->width + cx];
+    if ((*v | m) != *v){
+        *v |= m;
+        mark_dirty(c, cx, cy);
+    }
+}
+
+static void and_cell(struct BrailleCanvas *c, int cx, int cy, unsigned char m){
+    unsigned char *v = &c->cells[cy * c->width + cx];
+    if ((*v & m) != *v){
+        *v &= m;
+        mark_dirty(c, cx, cy);
+    }
+}
+
+void braille_set(struct BrailleCanvas *c, int x, int y){
+    if (c == NULL || !in_range(x, 0, c->dot_w - 1) || !in_range(y, 0, c->dot_h - 1))
+        return;
+    or_cell(c, x / BRAILLE_DOTS_W, y / BRAILLE_DOTS_H,
+            DOT[y % BRAILLE_DOTS_H][x % BRAILLE_DOTS_W]);
+}
+
+void braille_unset(struct BrailleCanvas *c, int x, int y){
+    if (c == NULL || !in_range(x, 0, c->dot_w - 1) || !in_range(y, 0, c->dot_h - 1))
+        return;
+    and_cell(c, x / BRAILLE_DOTS_W, y / BRAILLE_DOTS_H,
+             ~DOT[y % BRAILLE_DOTS_H][x % BRAILLE_DOTS_W]);
+}
+
+static void swap_int(int *a, int *b){
+    int t = *a;
+    *a = *b;
+    *b = t;
+}
+
+void braille_fill(struct BrailleCanvas *c, int x0, int y0, int x1, int y1){
+    int cx_first, cx_last, cy_first, cy_last, ry0, ry1, col0, col1;
+    unsigned char inner, m;
+    if (c == NULL)
+        return;
+    if (x0 > x1)
+        swap_int(&x0, &x1);
+    if (y0 > y1)
+        swap_int(&y0, &y1);
+    if (x1 < 0 || y1 < 0 || x0 >= c->dot_w || y0 >= c->dot_h)
+        return;
+    clamp_int(&x0, 0, c->dot_w - 1);
+    clamp_int(&x1, 0, c->dot_w - 1);
+    clamp_int(&y0, 0, c->dot_h - 1);
+    clamp_int(&y1, 0, c->dot_h - 1);
+
+    cx_first = x0 / BRAILLE_DOTS_W;
+    cx_last = x1 / BRAILLE_DOTS_W;
+    cy_first = y0 / BRAILLE_DOTS_H;
+    cy_last = y1 / BRAILLE_DOTS_H;
+    // cada cell recebe uma mascara so, apenas os cells da borda sao parciais
+    for (int cy = cy_first; cy <= cy_last; cy++){
+        ry0 = cy == cy_first ? y0 % BRAILLE_DOTS_H : 0;
+        ry1 = cy == cy_last ? y1 % BRAILLE_DOTS_H : BRAILLE_DOTS_H - 1;
+        inner = cell_mask(0, BRAILLE_DOTS_W - 1, ry0, ry1);
+        for (int cx = cx_first; cx <= cx_last; cx++){
+            if (cx != cx_first && cx != cx_last){
+                m = inner;
+            }else{
+                col0 = cx == cx_first ? x0 % BRAILLE_DOTS_W : 0;
+                col1 = cx == cx_last ? x1 % BRAILLE_DOTS_W : BRAILLE_DOTS_W - 1;
+                m = cell_mask(col0, col1, ry0, ry1);
+            }
+            or_cell(c, cx, cy, m);
+        }
+    }
+}
+
+void braille_hline(struct BrailleCanvas *c, int x0, int x1, int y){
+    braille_fill(c, x0, y, x1, y);
+}
+
+void braille_vline(struct BrailleCanvas *c, int x, int y0, int y1){
+    braille_fill(c, x, y0, x, y1);
+}
+
+void braille_rect(struct BrailleCanvas *c, int x0, int y0, int x1, int y1){
+    braille_hline(c, x0, x1, y0);
+    braille_hline(c, x0, x1, y1);
+    braille_vline(c, x0, y0, y1);
+    braille_vline(c, x1, y0, y1);
+}
+
+void braille_line(struct BrailleCanvas *c, int x0, int y0, int x1, int y1){
+    int dx, dy, sx, sy, err, e2, cx = -1, cy = -1;
+    unsigned char m = 0;
+    if (c == NULL)
+        return;
+    if (y0 == y1){
+        braille_hline(c, x0, x1, y0);
+        return;
+    }
+    if (x0 == x1){
+        braille_vline(c, x0, y0, y1);
+        return;
+    }
+
+    // Bresenham, os pontos seguidos no mesmo cell viram uma mascara so
+    dx = abs(x1 - x0);
+    dy = -abs(y1 - y0);
+    sx = x0 < x1 ? 1 : -1;
+    sy = y0 < y1 ? 1 : -1;
+    err = dx + dy;
+    for (;;){
+        if (in_range(x0, 0, c->dot_w - 1) && in_range(y0, 0, c->dot_h - 1)){
+            if (x0 / BRAILLE_DOTS_W != cx || y0 / BRAILLE_DOTS_H != cy){
+                if (m != 0)
+                    or_cell(c, cx, cy, m);
+                cx = x0 / BRAILLE_DOTS_W;
+                cy = y0 / BRAILLE_DOTS_H;
+                m = 0;
+            }
+            m |= DOT[y0 % BRAILLE_DOTS_H][x0 % BRAILLE_DOTS_W];
+        }
+        if (x0 == x1 && y0 == y1)
+            break;
+        e2 = 2 * err;
+        if (e2 >= dy){
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx){
+            err += dx;
+            y0 += sy;
+        }
+    }
+    if (m != 0)
+        or_cell(c, cx, cy, m);
+}
+
+void braille_plot(struct BrailleCanvas *c, const float *values, int n,
+                  float min, float max)
+{
+    int y, prev = -1;
+    float range = max - min;
+    if (c == NULL || values == NULL || range <= 0)
+        return;
+    if (n > c->dot_w)
+        n = c->dot_w;
+
+    for (int i = 0; i < n; i++){
+        y = (c->dot_h - 1) - (int)((values[i] - min) / range * (c->dot_h - 1) + 0.5f);
+        clamp_int(&y, 0, c->dot_h - 1);
+        // liga com o ponto anterior com uma coluna vertical
+        if (prev == -1)
+            braille_set(c, i, y);
+        else
+            braille_vline(c, i, prev, y);
+        prev = y;
+    }
+}
+
+static char quadrant_char(unsigned char v){
+    int q = 0;
+    if (v & (DOT[0][0] | DOT[1][0])) q |= 1;
+    if (v & (DOT[0][1] | DOT[1][1])) q |= 2;
+    if (v & (DOT[2][0] | DOT[3][0])) q |= 4;
+    if (v & (DOT[2][1] | DOT[3][1])) q |= 8;
+    return QUADRANT[q];
+}
+
+// Cell com dirty que precisa ser desenhado: mudou desde o ultimo render
+// (um cell apagado e desenhado igual no mesmo frame nao vai para a tela)
+static int shown_changed(struct BrailleCanvas *c, int i){
+    if (!c->redraw && c->shown[i] == c->cells[i])
+        return 0;
+    c->shown[i] = c->cells[i];
+    return 1;
+}
+
+int braille_to_view(struct BrailleCanvas *c, struct BaseView *vw){
+    uint64_t *word, bits;
+    int cx, n = 0;
+    if (c == NULL || vw == NULL)
+        return 0;
+
+    for (int cy = c->row_dirty_min; cy <= c->row_dirty_max; cy++){
+        for (int w = 0; w < c->words_per_row; w++){
+            word = &c->dirty[cy * c->words_per_row + w];
+            for (bits = *word; bits != 0; bits &= bits - 1){
+                cx = w * 64 + __builtin_ctzll(bits);
+                if (!shown_changed(c, cy * c->width + cx))
+                    continue;
+                set_value(vw, c->x + cx, c->y + cy,
+                          quadrant_char(c->cells[cy * c->width + cx]));
+                n++;
+            }
+            *word = 0;
+        }
+    }
+    c->row_dirty_min = c->height;
+    c->row_dirty_max = -1;
+    c->redraw = 0;
+
+    return n;
+}
+
+int braille_render(struct BrailleCanvas *c, struct OutBuf *ob){
+    uint64_t *word, bits;
+    unsigned char v;
+    char seq[32];
+    int cx, last, len, n = 0;
+    if (c == NULL || ob == NULL)
+        return -1;
+
+    for (int cy = c->row_dirty_min; cy <= c->row_dirty_max; cy++){
+        last = -2;
+        for (int w = 0; w < c->words_per_row; w++){
+            word = &c->dirty[cy * c->words_per_row + w];
+            for (bits = *word; bits != 0; bits &= bits - 1){
+                cx = w * 64 + __builtin_ctzll(bits);
+                if (!shown_changed(c, cy * c->width + cx))
+                    continue;
+                // cells seguidos nao precisam mover o cursor
+                if (cx != last + 1){
+                    len = snprintf(seq, sizeof(seq), "\x1b[%d;%dH", c->y + cy + 1, c->x + cx + 1);
+                    if (outbuf_append(ob, seq, len) == -1)
+                        return -1;
+                }
+                // U+2800 + v em UTF-8
+                v = c->cells[cy * c->width + cx];
+                seq[0] = 0xe2;
+                seq[1] = 0xa0 | (v >> 6);
+                seq[2] = 0x80 | (v & 0x3f);
+                if (outbuf_append(ob, seq, 3) == -1)
+                    return -1;
+                last = cx;
+                n++;
+            }
+            *word = 0;
+        }
+    }
+    c->row_dirty_min = c->height;
+    c->row_dirty_max = -1;
+    c->redraw = 0;
+    TRACE(TRACE_CELLS_EMITTED, n);
+
+    return n;
+}
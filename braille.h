@@ -0,0 +1,74 @@
+#ifndef BRAILLE_H_
+#define BRAILLE_H_
+#include <stdint.h>
+#include "view.h"
+
+// Canvas com resolucao de sub-cell usando os caracteres braille do unicode
+// (U+2800 - U+28FF): cada cell tem 2x4 pontos e o byte do cell eh
+// exatamente o padrao de bits do caracter, entao o bitmap fica com
+// 1 byte por cell. As primitivas trabalham por cell (OR de mascaras),
+// nao ponto a ponto, e marcam os cells alterados em um bitmap de dirty.
+// O render compara os cells com dirty com o ultimo valor desenhado, entao
+// limpar e desenhar de novo a cada frame so emite o que mudou na tela.
+// Esse ultimo valor eh do canvas, nao do destino: se a view ou a tela
+// forem apagadas por fora, chamar braille_invalidate.
+
+#define BRAILLE_DOTS_W 2
+#define BRAILLE_DOTS_H 4
+
+struct BrailleCanvas {
+    POSTYPE;                // x, y, width e height em cells
+    int dot_w, dot_h;       // tamanho em pontos
+    unsigned char *cells;   // width * height
+    unsigned char *shown;   // ultimo valor desenhado de cada cell
+    int redraw;             // proximo render desenha todo cell com dirty (braille_invalidate)
+    uint64_t *dirty;        // 1 bit por cell, words_per_row words por linha
+    int words_per_row;
+    int row_dirty_min, row_dirty_max;   // linhas com dirty, min > max se nenhuma
+};
+
+struct BrailleCanvas *create_braille(int width, int height, int x, int y);
+
+struct BrailleCanvas *destroy_braille(struct BrailleCanvas *c);
+
+// O destino perdeu o que o canvas desenhou (view preenchida de novo,
+// tela limpa): o proximo render escreve todos os cells
+void braille_invalidate(struct BrailleCanvas *c);
+
+// Apaga todos os pontos, so os cells que tinham algo ficam com dirty
+void braille_clear(struct BrailleCanvas *c);
+
+void braille_set(struct BrailleCanvas *c, int x, int y);
+
+void braille_unset(struct BrailleCanvas *c, int x, int y);
+
+// Linhas e retangulos em coordenadas de pontos, extremos inclusos
+void braille_hline(struct BrailleCanvas *c, int x0, int x1, int y);
+
+void braille_vline(struct BrailleCanvas *c, int x, int y0, int y1);
+
+void braille_line(struct BrailleCanvas *c, int x0, int y0, int x1, int y1);
+
+void braille_rect(struct BrailleCanvas *c, int x0, int y0, int x1, int y1);
+
+void braille_fill(struct BrailleCanvas *c, int x0, int y0, int x1, int y1);
+
+// Desenha a serie (n valores entre min e max) como um grafico de linha,
+// um valor por coluna de pontos, comecando na coluna 0
+void braille_plot(struct BrailleCanvas *c, const float *values, int n,
+                  float min, float max);
+
+// Os dois renderers abaixo so tocam cells com dirty e limpam o dirty,
+// use apenas um deles para cada canvas.
+
+// Escreve os cells em vw na posicao do canvas. Como o cell de BaseView
+// tem um byte, cada cell braille vira o caracter ASCII mais parecido
+// (por quadrante de 2x2 pontos)
+// retorna quantos cells foram escritos
+int braille_to_view(struct BrailleCanvas *c, struct BaseView *vw);
+
+// Escreve em ob os caracteres braille (UTF-8) com o cursor posicionado
+// em (c->x, c->y) no terminal
+// retorna quantos cells foram escritos, -1 se tiver erro
+int braille_render(struct BrailleCanvas *c, struct OutBuf *ob);
+#endif
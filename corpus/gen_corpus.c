@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "record.h"
+
+// Gera as capturas sinteticas usadas pelo make bench.
+// A semente eh fixa, entao os arquivos saem sempre iguais.
+// Uso: ./gen_corpus (escreve paste.cap, mouse_flood.cap e split_esc.cap
+// no diretorio atual)
+
+#define SEED 26
+
+static uint32_t rng_state = SEED;
+
+// xorshift32, so precisa ser igual em toda maquina
+static uint32_t rng(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// inteiro em [a, b]
+static int rng_range(int a, int b){
+    return a + (int)(rng() % (uint32_t)(b - a + 1));
+}
+
+static FILE *cap_open(const char *path){
+    struct CaptureHeader hdr;
+    FILE *fp;
+    if ((fp = fopen(path, "wb")) == NULL){
+        perror(path);
+        return NULL;
+    }
+    memcpy(hdr.magic, CAPTURE_MAGIC, 4);
+    hdr.version = CAPTURE_VERSION;
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    return fp;
+}
+
+static void cap_chunk(FILE *fp, uint64_t ts, const char *data, uint32_t len){
+    struct ChunkHeader ch;
+    memset(&ch, 0, sizeof(ch));
+    ch.ts = ts;
+    ch.len = len;
+    fwrite(&ch, sizeof(ch), 1, fp);
+    fwrite(data, 1, len, fp);
+}
+
+// ~256KB de texto colado, em reads do tamanho do buffer do tty
+static int gen_paste(const char *path){
+    static const char *words[] = {
+        "lorem", "ipsum", "termal", "view", "buffer",
+        "render", "evento", "mouse", "tecla", "linha",
+    };
+    static const int sizes[] = {4095, 4095, 4095, 1024, 512, 37};
+    size_t cap = 256 * 1024, len = 0, off, n;
+    uint64_t ts = 0;
+    char *text;
+    FILE *fp;
+    int nwords;
+
+    if ((text = malloc(cap + 256)) == NULL || (fp = cap_open(path)) == NULL){
+        free(text);
+        return -1;
+    }
+    while (len < cap){
+        nwords = rng_range(3, 12);
+        for (int i = 0; i < nwords; i++)
+            len += sprintf(text + len, "%s%s", i > 0 ? " " : "", words[rng() % 10]);
+        text[len++] = '\r';
+    }
+    for (off = 0; off < len; off += n, ts += 200000){
+        n = sizes[rng() % 6];
+        if (n > len - off)
+            n = len - off;
+        cap_chunk(fp, ts, text + off, n);
+    }
+    free(text);
+    fclose(fp);
+    return 0;
+}
+
+// relatorios de movimento do mouse (SGR), varios por read
+static int gen_mouse_flood(const char *path){
+    static const int buttons[] = {0, 32, 64, 65};
+    static const char finals[] = {'M', 'M', 'm'};
+    char buf[256];
+    uint64_t ts = 0;
+    int x = 40, y = 12, len, b;
+    FILE *fp;
+
+    if ((fp = cap_open(path)) == NULL)
+        return -1;
+    for (int i = 0; i < 4000; i++){
+        len = 0;
+        for (int j = rng_range(1, 8); j > 0; j--){
+            x += rng_range(-2, 2);
+            y += rng_range(-1, 1);
+            x = x < 1 ? 1 : x > 200 ? 200 : x;
+            y = y < 1 ? 1 : y > 60 ? 60 : y;
+            b = rng() % 10 != 0 ? 35 : buttons[rng() % 4];
+            len += sprintf(buf + len, "\x1b[<%d;%d;%d%c", b, x, y, finals[rng() % 3]);
+        }
+        cap_chunk(fp, ts, buf, len);
+        ts += rng_range(2000000, 8000000);
+    }
+    fclose(fp);
+    return 0;
+}
+
+// teclas e sequencias cortadas em pontos aleatorios, como chega pelo ssh
+static int gen_split_esc(const char *path){
+    static const char *keys[] = {
+        "\x1b[A", "\x1b[B", "\x1b[C", "\x1b[D", "\x1b[H", "\x1b[F",
+        "\x1bOP", "\x1b[15~", "\x1b[24~", "\x1b[1;5C", "\x1b[3~",
+        "\x1b[<0;10;5M", "\x1b[<0;10;5m", "a", "q", "\r",
+    };
+    size_t len = 0, off, n;
+    uint64_t ts = 0;
+    char *stream;
+    FILE *fp;
+
+    // a maior tecla tem 11 bytes
+    if ((stream = malloc(20000 * 12)) == NULL || (fp = cap_open(path)) == NULL){
+        free(stream);
+        return -1;
+    }
+    for (int i = 0; i < 20000; i++)
+        len += sprintf(stream + len, "%s", keys[rng() % 16]);
+    for (off = 0; off < len; off += n){
+        n = rng_range(1, 24);
+        if (n > len - off)
+            n = len - off;
+        cap_chunk(fp, ts, stream + off, n);
+        ts += rng_range(100000, 3000000);
+    }
+    free(stream);
+    fclose(fp);
+    return 0;
+}
+
+int main(void){
+    if (gen_paste("paste.cap") == -1 ||
+        gen_mouse_flood("mouse_flood.cap") == -1 ||
+        gen_split_esc("split_esc.cap") == -1)
+        return 1;
+    return 0;
+}
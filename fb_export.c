@@ -0,0 +1,275 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+#include "view.h"
+#include "fb_export.h"
+
+static size_t segment_size(int width, int height){
+    return sizeof(struct FbHeader) + (size_t)width * height;
+}
+
+// (Re)mapeia o segmento com o tamanho de width * height
+// O arquivo so cresce: um leitor com o mapeamento antigo nunca acessa
+// alem do fim do arquivo (SIGBUS)
+// retorna -1 em caso de erro
+static int fb_map(struct FbExport *fb, int width, int height){
+    size_t size = segment_size(width, height);
+    struct FbHeader *hdr;
+    uint64_t seq = 0, frame = 0;
+
+    if (size > fb->size){
+        if (fb->hdr != NULL){
+            seq = fb->hdr->seq;
+            frame = fb->hdr->frame;
+        }
+        if (ftruncate(fb->fd, size) == -1)
+            return -1;
+        hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fb->fd, 0);
+        if (hdr == MAP_FAILED)
+            return -1;
+        if (fb->hdr != NULL)
+            munmap(fb->hdr, fb->size);
+        fb->hdr = hdr;
+        fb->size = size;
+        fb->cells = (char *)(fb->hdr + 1);
+        fb->hdr->seq = seq;
+        fb->hdr->frame = frame;
+    }
+
+    memcpy(fb->hdr->magic, FB_MAGIC, 4);
+    fb->hdr->version = FB_VERSION;
+    fb->hdr->width = width;
+    fb->hdr->height = height;
+    fb->hdr->ndamage = 0;
+    memset(fb->cells, TRANSPARENT_PIXEL, (size_t)width * height);
+
+    return 0;
+}
+
+struct FbExport *fb_export_open(const char *name, int width, int height){
+    struct FbExport *fb;
+    if (width <= 0 || height <= 0)
+        return NULL;
+    if ((fb = calloc(1, sizeof(struct FbExport))) == NULL)
+        return NULL;
+
+    if (name != NULL){
+        strncpy(fb->name, name, sizeof(fb->name) - 1);
+        fb->fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    }else{
+        fb->fd = memfd_create("termal-fb", MFD_CLOEXEC);
+    }
+    if (fb->fd == -1){
+        free(fb);
+        return NULL;
+    }
+    if (fb_map(fb, width, height) == -1)
+        return fb_export_close(fb);
+
+    return fb;
+}
+
+struct FbExport *fb_export_close(struct FbExport *fb){
+    if (fb == NULL)
+        return NULL;
+    if (fb->hdr != NULL)
+        munmap(fb->hdr, fb->size);
+    close(fb->fd);
+    if (fb->name[0] != '\0')
+        shm_unlink(fb->name);
+    free(fb);
+
+    return NULL;
+}
+
+// Adiciona a linha y, colunas [x0, x1], ao damage
+// linhas consecutivas com damage viram um unico retangulo; depois de
+// passar de FB_MAX_DAMAGE fica tudo em um retangulo so ate o fim do frame
+static void add_damage(struct Rect *all, int *n, int *full,
+                       int y, int x0, int x1)
+{
+    struct Rect *r = *n > 0 ? &all[*n - 1] : NULL;
+    int rx1;
+
+    if (r != NULL && (*full || r->y + r->height == y)){
+        rx1 = r->x + r->width - 1;
+        if (x0 < r->x)
+            r->x = x0;
+        if (x1 > rx1)
+            rx1 = x1;
+        r->width = rx1 - r->x + 1;
+        r->height = y - r->y + 1;
+        return;
+    }
+    // passou do limite, junta tudo em um retangulo so
+    if (*n == FB_MAX_DAMAGE){
+        for (int i = 1; i < *n; i++){
+            rx1 = all[0].x + all[0].width - 1;
+            if (all[i].x < all[0].x)
+                all[0].x = all[i].x;
+            if (all[i].x + all[i].width - 1 > rx1)
+                rx1 = all[i].x + all[i].width - 1;
+            all[0].width = rx1 - all[0].x + 1;
+        }
+        *n = 1;
+        *full = 1;
+        add_damage(all, n, full, y, x0, x1);
+        return;
+    }
+    all[*n].x = x0;
+    all[*n].y = y;
+    all[*n].width = x1 - x0 + 1;
+    all[*n].height = 1;
+    (*n)++;
+}
+
+int fb_export_publish(struct FbExport *fb, struct BaseView *vw){
+    struct Rect damage[FB_MAX_DAMAGE];
+    int ndamage = 0, full = 0, changed = 0, x0, x1 = 0;
+    uint64_t seq;
+    const char *src;
+    char *dst;
+
+    if (fb == NULL || vw == NULL)
+        return -1;
+
+    seq = __atomic_load_n(&fb->hdr->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&fb->hdr->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if ((int)fb->hdr->width != vw->width || (int)fb->hdr->height != vw->height){
+        if (fb_map(fb, vw->width, vw->height) == -1)
+            return -1;
+        // fb_map preserva o seq, que continua impar ate o fim da escrita
+    }
+
+    for (int y = 0; y < vw->height; y++){
+        src = view_row(vw, y);
+        dst = &fb->cells[y * vw->width];
+        x0 = -1;
+        for (int x = 0; x < vw->width; x++){
+            if (src[x] != dst[x]){
+                if (x0 == -1)
+                    x0 = x;
+                x1 = x;
+                dst[x] = src[x];
+                changed++;
+            }
+        }
+        if (x0 != -1)
+            add_damage(damage, &ndamage, &full, y, x0, x1);
+    }
+    TRACE(TRACE_CELLS_DIFFED, vw->width * vw->height);
+
+    fb->hdr->ndamage = ndamage;
+    memcpy(fb->hdr->damage, damage, sizeof(struct Rect) * ndamage);
+    fb->hdr->frame++;
+    __atomic_store_n(&fb->hdr->seq, seq + 2, __ATOMIC_RELEASE);
+
+    return changed;
+}
+
+struct FbReader *fb_reader_open(const char *name){
+    struct FbReader *rd;
+    struct stat st;
+    if (name == NULL || (rd = calloc(1, sizeof(struct FbReader))) == NULL)
+        return NULL;
+
+    rd->fd = name[0] == '/' && strchr(name + 1, '/') == NULL
+           ? shm_open(name, O_RDONLY, 0)
+           : open(name, O_RDONLY | O_CLOEXEC);
+    if (rd->fd == -1){
+        free(rd);
+        return NULL;
+    }
+    if (fstat(rd->fd, &st) == -1 || (size_t)st.st_size < sizeof(struct FbHeader))
+        return fb_reader_close(rd);
+    rd->hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, rd->fd, 0);
+    if (rd->hdr == MAP_FAILED){
+        rd->hdr = NULL;
+        return fb_reader_close(rd);
+    }
+    rd->size = st.st_size;
+
+    return rd;
+}
+
+struct FbReader *fb_reader_close(struct FbReader *rd){
+    if (rd == NULL)
+        return NULL;
+    if (rd->hdr != NULL)
+        munmap((void *)rd->hdr, rd->size);
+    close(rd->fd);
+    free(rd);
+
+    return NULL;
+}
+
+// Mapeia de novo com o tamanho atual do arquivo
+// retorna -1 em caso de erro
+static int reader_remap(struct FbReader *rd){
+    const struct FbHeader *hdr;
+    struct stat st;
+    if (fstat(rd->fd, &st) == -1 || (size_t)st.st_size <= rd->size)
+        return -1;
+    hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, rd->fd, 0);
+    if (hdr == MAP_FAILED)
+        return -1;
+    munmap((void *)rd->hdr, rd->size);
+    rd->hdr = hdr;
+    rd->size = st.st_size;
+    return 0;
+}
+
+int64_t fb_read_frame(struct FbReader *rd, char *out, size_t sz,
+                      struct FbHeader *meta)
+{
+    const struct FbHeader *hdr;
+    uint64_t s1, s2, frame;
+    size_t n, need;
+    int spins = 0;
+
+    if (rd == NULL || rd->hdr == NULL ||
+        memcmp(rd->hdr->magic, FB_MAGIC, 4) != 0 || rd->hdr->version != FB_VERSION)
+        return -1;
+    for (;;){
+        hdr = rd->hdr;
+        // escritor no meio de um frame, ou morreu com o seq impar
+        if ((s1 = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE)) & 1){
+            if (++spins >= FB_READ_SPINS)
+                return -1;
+            sched_yield();
+            continue;
+        }
+        if (meta != NULL)
+            memcpy(meta, hdr, sizeof(*meta));
+        need = segment_size(hdr->width, hdr->height);
+        // width/height podem estar mudando, nunca le alem do mapeado
+        n = (size_t)hdr->width * hdr->height;
+        if (n > rd->size - sizeof(struct FbHeader))
+            n = rd->size - sizeof(struct FbHeader);
+        if (n > sz)
+            n = sz;
+        if (out != NULL)
+            memcpy(out, (const char *)(hdr + 1), n);
+        frame = hdr->frame;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s2 = __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED);
+        if (s1 != s2)
+            continue;
+        // frame consistente, mas maior do que o mapeamento: remapeia e le de novo
+        if (need > rd->size){
+            if (reader_remap(rd) == -1)
+                return -1;
+            continue;
+        }
+        return frame;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef FB_EXPORT_H_
+#define FB_EXPORT_H_
+#include <stdint.h>
+#include <stddef.h>
+#include "view.h"
+
+// Exporta o frame composto (celulas da view raiz) em memoria compartilhada,
+// para que outro processo leia sem ter que interpretar o stream ANSI.
+//
+// Layout do segmento: struct FbHeader seguido de width * height chars.
+// Cada char eh um cell da view: o caracter ASCII nos 7 bits de baixo
+// (CELL_CHAR) e o bit CELL_HIGHLIGHT (0x80) para video reverso;
+// TRANSPARENT_PIXEL (0) eh um cell que nunca foi desenhado.
+// O seq funciona como seqlock: fica impar enquanto o frame eh escrito.
+// Leitor: le seq (par), copia header e celulas, le seq de novo,
+// se mudou tenta de novo (ver fb_read_frame).
+// Se width/height crescerem o segmento cresce e o leitor remapeia; o
+// segmento nunca diminui, entao um mapeamento antigo continua valido.
+
+#define FB_MAGIC      "TFB1"
+#define FB_VERSION    2
+#define FB_MAX_DAMAGE 32
+// tentativas do leitor com o seq impar antes de desistir
+#define FB_READ_SPINS 100000
+
+struct FbHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height;
+    uint64_t seq;
+    uint64_t frame;         // numero do frame publicado
+    uint32_t ndamage;       // retangulos que mudaram desde o frame anterior
+    struct Rect damage[FB_MAX_DAMAGE];
+};
+
+struct FbExport {
+    int fd;
+    size_t size;            // tamanho do segmento, so cresce
+    struct FbHeader *hdr;
+    char *cells;
+    char name[64];          // vazio se for memfd
+};
+
+// name (ex: "/termal") cria com shm_open, NULL cria com memfd_create
+// (o leitor acessa por /proc/<pid>/fd/<fd> ou recebendo o fd)
+// retorna NULL em caso de erro
+struct FbExport *fb_export_open(const char *name, int width, int height);
+
+struct FbExport *fb_export_close(struct FbExport *fb);
+
+// Copia vw para o segmento, calcula o damage e incrementa o frame
+// retorna quantas celulas mudaram, -1 em caso de erro
+int fb_export_publish(struct FbExport *fb, struct BaseView *vw);
+
+struct FbReader {
+    int fd;
+    size_t size;            // tamanho mapeado
+    const struct FbHeader *hdr;
+};
+
+// Abre o segmento de outro processo so para leitura
+// name eh o mesmo do fb_export_open (shm) ou um caminho (/proc/<pid>/fd/<fd>)
+// retorna NULL em caso de erro
+struct FbReader *fb_reader_open(const char *name);
+
+struct FbReader *fb_reader_close(struct FbReader *rd);
+
+// Copia um frame consistente para out (ate sz chars) e o header para meta.
+// Remapeia se o segmento cresceu.
+// retorna o numero do frame, -1 se o segmento nao for valido ou se o
+// escritor ficou no meio de um frame por FB_READ_SPINS tentativas
+int64_t fb_read_frame(struct FbReader *rd, char *out, size_t sz,
+                      struct FbHeader *meta);
+#endif
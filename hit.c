@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "trace.h"
+#include "view.h"
+#include "hit.h"
+
+static int valid_id(struct HitGrid *g, int id){
+    return g != NULL && id >= 0 && id < g->nentries && g->entries[id].used;
+}
+
+// a fica em cima de b
+static int above(struct HitEntry *a, struct HitEntry *b){
+    return a->z > b->z || (a->z == b->z && a->seq > b->seq);
+}
+
+// Celulas da grade que r cobre, -1 se nenhuma
+static int cell_span(struct HitGrid *g, const struct Rect *r,
+                     int *c0, int *r0, int *c1, int *r1)
+{
+    int x0 = r->x, y0 = r->y;
+    int x1 = r->x + r->width - 1, y1 = r->y + r->height - 1;
+    if (r->width <= 0 || r->height <= 0 ||
+        x1 < 0 || y1 < 0 || x0 >= g->width || y0 >= g->height)
+        return -1;
+    clamp_int(&x0, 0, g->width - 1);
+    clamp_int(&y0, 0, g->height - 1);
+    clamp_int(&x1, 0, g->width - 1);
+    clamp_int(&y1, 0, g->height - 1);
+    *c0 = x0 / HIT_CELL_W;
+    *r0 = y0 / HIT_CELL_H;
+    *c1 = x1 / HIT_CELL_W;
+    *r1 = y1 / HIT_CELL_H;
+    return 0;
+}
+
+// Insere id na lista da celula mantendo a ordem do topo para baixo
+static int cell_insert(struct HitGrid *g, struct HitCell *c, int id){
+    int *tmp, cap, i;
+    if (c->n == c->cap){
+        cap = c->cap == 0 ? 4 : c->cap * 2;
+        if ((tmp = realloc(c->ids, sizeof(int) * cap)) == NULL)
+            return -1;
+        c->ids = tmp;
+        c->cap = cap;
+    }
+    for (i = c->n; i > 0 && above(&g->entries[id], &g->entries[c->ids[i - 1]]); i--)
+        c->ids[i] = c->ids[i - 1];
+    c->ids[i] = id;
+    c->n++;
+    return 0;
+}
+
+static void cell_delete(struct HitCell *c, int id){
+    for (int i = 0; i < c->n; i++){
+        if (c->ids[i] == id){
+            memmove(&c->ids[i], &c->ids[i + 1], sizeof(int) * (c->n - i - 1));
+            c->n--;
+            return;
+        }
+    }
+}
+
+static void unlink_entry(struct HitGrid *g, int id){
+    int c0, r0, c1, r1;
+    if (cell_span(g, &g->entries[id].r, &c0, &r0, &c1, &r1) == -1)
+        return;
+    for (int row = r0; row <= r1; row++)
+        for (int col = c0; col <= c1; col++)
+            cell_delete(&g->cells[row * g->cols + col], id);
+}
+
+static int link_entry(struct HitGrid *g, int id){
+    int c0, r0, c1, r1;
+    if (cell_span(g, &g->entries[id].r, &c0, &r0, &c1, &r1) == -1)
+        return 0;
+    for (int row = r0; row <= r1; row++)
+        for (int col = c0; col <= c1; col++)
+            if (cell_insert(g, &g->cells[row * g->cols + col], id) == -1)
+                return -1;
+    return 0;
+}
+
+static void free_cells(struct HitGrid *g){
+    if (g->cells == NULL)
+        return;
+    for (int i = 0; i < g->cols * g->rows; i++)
+        free(g->cells[i].ids);
+    free(g->cells);
+    g->cells = NULL;
+}
+
+// Tira id das celulas e coloca na lista de ids livres
+static void drop_entry(struct HitGrid *g, int id){
+    unlink_entry(g, id);
+    g->entries[id].used = 0;
+    g->entries[id].next_free = g->free_head;
+    g->free_head = id;
+    if (g->hover == id)
+        g->hover = HIT_NONE;
+}
+
+struct HitGrid *create_hit_grid(int width, int height){
+    struct HitGrid *g = calloc(1, sizeof(struct HitGrid));
+    if (g == NULL)
+        return NULL;
+    g->hover = HIT_NONE;
+    g->free_head = HIT_NONE;
+    if (hit_resize(g, width, height) == -1)
+        return destroy_hit_grid(g);
+
+    return g;
+}
+
+struct HitGrid *destroy_hit_grid(struct HitGrid *g){
+    if (g == NULL)
+        return NULL;
+    free_cells(g);
+    free(g->entries);
+    free(g);
+
+    return NULL;
+}
+
+int hit_resize(struct HitGrid *g, int width, int height){
+    struct HitGrid tmp;
+    if (g == NULL || width <= 0 || height <= 0)
+        return -1;
+    // a grade nova eh montada em tmp (as entradas sao so lidas) e so
+    // troca com a de g se tudo der certo, com erro g fica como estava
+    tmp = *g;
+    tmp.cols = (width + HIT_CELL_W - 1) / HIT_CELL_W;
+    tmp.rows = (height + HIT_CELL_H - 1) / HIT_CELL_H;
+    tmp.width = width;
+    tmp.height = height;
+    if ((tmp.cells = calloc(tmp.cols * tmp.rows, sizeof(struct HitCell))) == NULL)
+        return -1;
+    for (int id = 0; id < tmp.nentries; id++){
+        if (tmp.entries[id].used && link_entry(&tmp, id) == -1){
+            free_cells(&tmp);
+            return -1;
+        }
+    }
+
+    free_cells(g);
+    g->cells = tmp.cells;
+    g->cols = tmp.cols;
+    g->rows = tmp.rows;
+    g->width = width;
+    g->height = height;
+    return 0;
+}
+
+int hit_add(struct HitGrid *g, struct Rect r, struct BaseView *vw, int z, void *data){
+    struct HitEntry *tmp, *e;
+    int id, cap;
+    if (g == NULL)
+        return HIT_NONE;
+
+    // reaproveita um id removido
+    if ((id = g->free_head) != HIT_NONE){
+        g->free_head = g->entries[id].next_free;
+    }else{
+        if (g->nentries == g->cap){
+            cap = g->cap == 0 ? 16 : g->cap * 2;
+            if ((tmp = realloc(g->entries, sizeof(struct HitEntry) * cap)) == NULL)
+                return HIT_NONE;
+            g->entries = tmp;
+            g->cap = cap;
+        }
+        id = g->nentries++;
+    }
+    e = &g->entries[id];
+    e->r = r;
+    e->vw = vw;
+    e->data = data;
+    e->z = z;
+    e->seq = g->seq++;
+    e->used = 1;
+    if (link_entry(g, id) == -1){
+        drop_entry(g, id);
+        return HIT_NONE;
+    }
+
+    return id;
+}
+
+int hit_add_view(struct HitGrid *g, struct BaseView *vw, int z, void *data){
+    struct Rect r;
+    if (vw == NULL)
+        return HIT_NONE;
+    r.x = vw->x;
+    r.y = vw->y;
+    r.width = vw->width;
+    r.height = vw->height;
+    return hit_add(g, r, vw, z, data);
+}
+
+int hit_move(struct HitGrid *g, int id, struct Rect r){
+    struct HitEntry *e;
+    if (!valid_id(g, id))
+        return -1;
+    e = &g->entries[id];
+    if (e->r.x == r.x && e->r.y == r.y && e->r.width == r.width && e->r.height == r.height)
+        return 0;
+    unlink_entry(g, id);
+    e->r = r;
+    // ligado so em parte das celulas o retangulo sumiria em algumas
+    if (link_entry(g, id) == -1){
+        drop_entry(g, id);
+        return -1;
+    }
+    return 0;
+}
+
+int hit_update_view(struct HitGrid *g, int id){
+    struct BaseView *vw;
+    struct Rect r;
+    if (!valid_id(g, id) || (vw = g->entries[id].vw) == NULL)
+        return -1;
+    r.x = vw->x;
+    r.y = vw->y;
+    r.width = vw->width;
+    r.height = vw->height;
+    return hit_move(g, id, r);
+}
+
+int hit_set_z(struct HitGrid *g, int id, int z){
+    if (!valid_id(g, id))
+        return -1;
+    if (g->entries[id].z == z)
+        return 0;
+    // religa para reordenar as listas
+    unlink_entry(g, id);
+    g->entries[id].z = z;
+    if (link_entry(g, id) == -1){
+        drop_entry(g, id);
+        return -1;
+    }
+    return 0;
+}
+
+void hit_remove(struct HitGrid *g, int id){
+    if (valid_id(g, id))
+        drop_entry(g, id);
+}
+
+int hit_test(struct HitGrid *g, int x, int y){
+    struct HitCell *c;
+    struct HitEntry *e;
+    if (g == NULL || !in_range(x, 0, g->width - 1) || !in_range(y, 0, g->height - 1))
+        return HIT_NONE;
+
+    c = &g->cells[(y / HIT_CELL_H) * g->cols + x / HIT_CELL_W];
+    for (int i = 0; i < c->n; i++){
+        e = &g->entries[c->ids[i]];
+        if (!in_range(x, e->r.x, e->r.x + e->r.width - 1) ||
+            !in_range(y, e->r.y, e->r.y + e->r.height - 1))
+            continue;
+        // cell transparente deixa passar para a view de baixo
+        if (e->vw != NULL &&
+            in_range(x - e->r.x, 0, e->vw->width - 1) &&
+            in_range(y - e->r.y, 0, e->vw->height - 1) &&
+            view_row(e->vw, y - e->r.y)[x - e->r.x] == TRANSPARENT_PIXEL)
+            continue;
+        return c->ids[i];
+    }
+
+    return HIT_NONE;
+}
+
+void *hit_data(struct HitGrid *g, int id){
+    return valid_id(g, id) ? g->entries[id].data : NULL;
+}
+
+void hit_motion(struct HitGrid *g, int x, int y){
+    if (g == NULL)
+        return;
+    if (g->pending)
+        TRACE(TRACE_EVENTS_COALESCED, 1);
+    g->pending = 1;
+    g->px = x;
+    g->py = y;
+}
+
+int hit_hover_update(struct HitGrid *g){
+    int id;
+    if (g == NULL || !g->pending)
+        return 0;
+    g->pending = 0;
+    id = hit_test(g, g->px, g->py);
+    if (id == g->hover)
+        return 0;
+    g->hover = id;
+    return 1;
+}
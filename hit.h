@@ -0,0 +1,87 @@
+#ifndef HIT_H_
+#define HIT_H_
+#include "view.h"
+
+// Indice espacial para saber qual view esta embaixo do mouse.
+// A tela eh dividida em uma grade uniforme de HIT_CELL_W x HIT_CELL_H
+// cells; cada celula da grade guarda os retangulos que passam por ela,
+// ordenados do topo para baixo (z maior primeiro). O teste de um ponto
+// so olha a lista da celula dele, O(1) esperado, e pula cells
+// transparentes da view. Mover um retangulo so mexe nas celulas dele.
+
+#define HIT_CELL_W 8
+#define HIT_CELL_H 4
+#define HIT_NONE   (-1)
+
+struct HitEntry {
+    struct Rect r;
+    struct BaseView *vw;    // NULL = retangulo opaco
+    void *data;
+    int z;
+    unsigned seq;           // desempate do z: o mais novo fica em cima
+    int used;
+    int next_free;          // proximo id livre, se !used
+};
+
+struct HitCell {
+    int *ids;
+    int n, cap;
+};
+
+struct HitGrid {
+    int width, height;      // area coberta, em cells do terminal
+    int cols, rows;         // tamanho da grade
+    struct HitCell *cells;
+    struct HitEntry *entries;
+    int nentries, cap;
+    int free_head;          // ids removidos, HIT_NONE se nenhum
+    unsigned seq;
+    // hover: a ultima posicao recebida so eh resolvida em hit_hover_update
+    int hover;
+    int pending, px, py;
+};
+
+// retorna NULL em caso de erro
+struct HitGrid *create_hit_grid(int width, int height);
+
+struct HitGrid *destroy_hit_grid(struct HitGrid *g);
+
+// Muda a area coberta e refaz a grade
+// retorna -1 em caso de erro, a grade antiga continua valendo
+int hit_resize(struct HitGrid *g, int width, int height);
+
+// Adiciona o retangulo r na camada z; com vw os cells transparentes
+// de vw nao contam (vw deve ter o tamanho de r)
+// retorna o id, HIT_NONE em caso de erro
+int hit_add(struct HitGrid *g, struct Rect r, struct BaseView *vw, int z, void *data);
+
+// hit_add com o retangulo da propria view
+int hit_add_view(struct HitGrid *g, struct BaseView *vw, int z, void *data);
+
+// Muda o retangulo de id, so as celulas antigas e novas sao tocadas
+// retorna -1 em caso de erro, nesse caso id eh removido
+int hit_move(struct HitGrid *g, int id, struct Rect r);
+
+// Le de novo a posicao e o tamanho da view de id
+// retorna -1 em caso de erro, nesse caso id eh removido
+int hit_update_view(struct HitGrid *g, int id);
+
+// retorna -1 em caso de erro, nesse caso id eh removido
+int hit_set_z(struct HitGrid *g, int id, int z);
+
+void hit_remove(struct HitGrid *g, int id);
+
+// retorna o id do retangulo mais em cima que nao eh transparente em
+// (x, y), HIT_NONE se nao tiver
+int hit_test(struct HitGrid *g, int x, int y);
+
+void *hit_data(struct HitGrid *g, int id);
+
+// Guarda a posicao de um evento de movimento. Varios eventos antes do
+// hit_hover_update viram um so (TRACE_EVENTS_COALESCED)
+void hit_motion(struct HitGrid *g, int x, int y);
+
+// Resolve a ultima posicao guardada
+// retorna 1 se g->hover mudou
+int hit_hover_update(struct HitGrid *g);
+#endif
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "view.h"
+#include "layout.h"
+
+static int rect_eq(const struct Rect *a, const struct Rect *b){
+    return a->x == b->x && a->y == b->y &&
+           a->width == b->width && a->height == b->height;
+}
+
+static int rect_contains(const struct Rect *a, const struct Rect *b){
+    return b->x >= a->x && b->y >= a->y &&
+           b->x + b->width <= a->x + a->width &&
+           b->y + b->height <= a->y + a->height;
+}
+
+static void rect_union(struct Rect *a, const struct Rect *b){
+    int x1 = a->x + a->width, y1 = a->y + a->height;
+    if (b->x + b->width > x1)
+        x1 = b->x + b->width;
+    if (b->y + b->height > y1)
+        y1 = b->y + b->height;
+    if (b->x < a->x)
+        a->x = b->x;
+    if (b->y < a->y)
+        a->y = b->y;
+    a->width = x1 - a->x;
+    a->height = y1 - a->y;
+}
+
+static void add_damage(struct Layout *l, const struct Rect *r){
+    if (r->width <= 0 || r->height <= 0)
+        return;
+    for (int i = 0; i < l->ndamage; i++)
+        if (rect_contains(&l->damage[i], r))
+            return;
+    // passou do limite, junta tudo em um retangulo so
+    if (l->ndamage == LAYOUT_MAX_DAMAGE){
+        for (int i = 1; i < l->ndamage; i++)
+            rect_union(&l->damage[0], &l->damage[i]);
+        rect_union(&l->damage[0], r);
+        l->ndamage = 1;
+        return;
+    }
+    l->damage[l->ndamage++] = *r;
+}
+
+// Marca n e avisa os ancestrais que tem algo para recalcular embaixo
+static void mark(struct LayoutNode *n){
+    struct LayoutNode *p;
+    if (n == NULL)
+        return;
+    n->dirty = 1;
+    for (p = n->parent; p != NULL && !p->child_dirty; p = p->parent)
+        p->child_dirty = 1;
+}
+
+static struct LayoutNode *new_node(struct Layout *l, int direction,
+                                   int size_kind, int size)
+{
+    struct LayoutNode *n = calloc(1, sizeof(struct LayoutNode));
+    if (n == NULL)
+        return NULL;
+    n->direction = direction;
+    n->size_kind = size_kind;
+    n->size = size;
+    n->min = 0;
+    n->max = LAYOUT_NO_MAX;
+    n->tree = l;
+    n->dirty = 1;
+    return n;
+}
+
+static void free_node(struct LayoutNode *n){
+    for (int i = 0; i < n->nchildren; i++)
+        free_node(n->children[i]);
+    free(n->children);
+    free(n);
+}
+
+struct Layout *create_layout(int width, int height, int direction){
+    struct Layout *l = calloc(1, sizeof(struct Layout));
+    if (l == NULL)
+        return NULL;
+    if ((l->root = new_node(l, direction, SIZE_FLEX, 1)) == NULL){
+        free(l);
+        return NULL;
+    }
+    layout_resize(l, width, height);
+
+    return l;
+}
+
+struct Layout *destroy_layout(struct Layout *l){
+    if (l == NULL)
+        return NULL;
+    free_node(l->root);
+    free(l);
+
+    return NULL;
+}
+
+struct LayoutNode *layout_add(struct LayoutNode *parent, int direction,
+                              int size_kind, int size)
+{
+    struct LayoutNode *n, **tmp;
+    int cap;
+    if (parent == NULL)
+        return NULL;
+    if (parent->nchildren == parent->cap){
+        cap = parent->cap == 0 ? 4 : parent->cap * 2;
+        if ((tmp = realloc(parent->children, sizeof(struct LayoutNode *) * cap)) == NULL)
+            return NULL;
+        parent->children = tmp;
+        parent->cap = cap;
+    }
+    if ((n = new_node(parent->tree, direction, size_kind, size)) == NULL)
+        return NULL;
+    n->parent = parent;
+    parent->children[parent->nchildren++] = n;
+    mark(parent);
+
+    return n;
+}
+
+void layout_remove(struct LayoutNode *n){
+    struct LayoutNode *p;
+    int i;
+    if (n == NULL || (p = n->parent) == NULL)
+        return;
+    for (i = 0; i < p->nchildren && p->children[i] != n; i++)
+        ;
+    if (i == p->nchildren)
+        return;
+    memmove(&p->children[i], &p->children[i + 1],
+            sizeof(struct LayoutNode *) * (p->nchildren - i - 1));
+    p->nchildren--;
+    add_damage(n->tree, &n->rect);
+    free_node(n);
+    mark(p);
+}
+
+void layout_set_size(struct LayoutNode *n, int size_kind, int size){
+    if (n == NULL || (n->size_kind == size_kind && n->size == size))
+        return;
+    n->size_kind = size_kind;
+    n->size = size;
+    // muda a divisao entre os irmaos
+    mark(n->parent);
+}
+
+void layout_set_limits(struct LayoutNode *n, int min, int max){
+    if (n == NULL || (n->min == min && n->max == max))
+        return;
+    n->min = min;
+    n->max = max;
+    mark(n->parent);
+}
+
+void layout_set_box(struct LayoutNode *n, int gap, int padding){
+    if (n == NULL || (n->gap == gap && n->padding == padding))
+        return;
+    n->gap = gap;
+    n->padding = padding;
+    mark(n);
+}
+
+void layout_bind(struct LayoutNode *n,
+                 void (*apply)(struct LayoutNode *n, void *target), void *target)
+{
+    if (n == NULL)
+        return;
+    n->apply = apply;
+    n->target = target;
+    if (apply != NULL)
+        apply(n, target);
+}
+
+void layout_invalidate(struct LayoutNode *n){
+    mark(n);
+}
+
+void layout_resize(struct Layout *l, int width, int height){
+    if (l == NULL || (l->root->rect.width == width && l->root->rect.height == height))
+        return;
+    add_damage(l, &l->root->rect);
+    l->root->rect.width = width;
+    l->root->rect.height = height;
+    add_damage(l, &l->root->rect);
+    if (l->root->apply != NULL)
+        l->root->apply(l->root, l->root->target);
+    mark(l->root);
+}
+
+static int clamp_size(struct LayoutNode *n, int v){
+    if (v > n->max)
+        v = n->max;
+    if (v < n->min)
+        v = n->min;
+    return v < 0 ? 0 : v;
+}
+
+// Calcula o measured de cada filho de n para o espaco avail
+static void measure_children(struct LayoutNode *n, int avail){
+    struct LayoutNode *c;
+    int used = 0, weights = 0, restart, share, acc, left;
+
+    for (int i = 0; i < n->nchildren; i++){
+        c = n->children[i];
+        c->frozen = c->size_kind != SIZE_FLEX;
+        switch (c->size_kind){
+            case SIZE_FIXED:   c->measured = clamp_size(c, c->size); break;
+            case SIZE_PERCENT: c->measured = clamp_size(c, (long)avail * c->size / 100); break;
+            default:
+                c->measured = 0;
+                weights += c->size > 0 ? c->size : 0;
+                continue;
+        }
+        used += c->measured;
+    }
+
+    // flex: divide o que sobrou pelos pesos, quem passar do min/max fica
+    // com o limite e o resto eh dividido de novo entre os outros
+    do {
+        restart = 0;
+        left = avail - used > 0 ? avail - used : 0;
+        acc = 0;
+        for (int i = 0; i < n->nchildren && weights > 0; i++){
+            c = n->children[i];
+            if (c->frozen)
+                continue;
+            // arredondamento acumulado, a soma fecha exatamente em left
+            share = (long)left * (acc + c->size) / weights - (long)left * acc / weights;
+            acc += c->size;
+            if (share != clamp_size(c, share)){
+                c->measured = clamp_size(c, share);
+                c->frozen = 1;
+                used += c->measured;
+                weights -= c->size;
+                restart = 1;
+                break;
+            }
+            c->measured = share;
+        }
+    } while (restart);
+}
+
+static void layout_node(struct Layout *l, struct LayoutNode *n,
+                        const struct Rect *r, int covered);
+
+// Redistribui os filhos de n dentro do rect dele
+static void distribute(struct Layout *l, struct LayoutNode *n, int covered){
+    struct LayoutNode *c;
+    struct Rect inner = n->rect, cr;
+    int avail, pos;
+
+    if (n->nchildren == 0)
+        return;
+    l->relaid++;
+    inner.x += n->padding;
+    inner.y += n->padding;
+    inner.width = inner.width - 2 * n->padding > 0 ? inner.width - 2 * n->padding : 0;
+    inner.height = inner.height - 2 * n->padding > 0 ? inner.height - 2 * n->padding : 0;
+    avail = n->direction == LAYOUT_ROW ? inner.width : inner.height;
+    if (n->nchildren > 1)
+        avail -= n->gap * (n->nchildren - 1);
+    measure_children(n, avail > 0 ? avail : 0);
+
+    pos = n->direction == LAYOUT_ROW ? inner.x : inner.y;
+    for (int i = 0; i < n->nchildren; i++){
+        c = n->children[i];
+        cr = inner;
+        if (n->direction == LAYOUT_ROW){
+            cr.x = pos;
+            cr.width = c->measured;
+        }else{
+            cr.y = pos;
+            cr.height = c->measured;
+        }
+        layout_node(l, c, &cr, covered);
+        pos += c->measured + n->gap;
+    }
+}
+
+// covered: um ancestral ja colocou o retangulo antigo e o novo no damage
+static void layout_node(struct Layout *l, struct LayoutNode *n,
+                        const struct Rect *r, int covered)
+{
+    if (!rect_eq(&n->rect, r)){
+        if (!covered){
+            add_damage(l, &n->rect);
+            add_damage(l, r);
+            covered = 1;
+        }
+        n->rect = *r;
+        if (n->apply != NULL)
+            n->apply(n, n->target);
+        n->dirty = 1;
+    }
+
+    if (n->dirty){
+        distribute(l, n, covered);
+    }else if (n->child_dirty){
+        // mesmo retangulo, so os filhos marcados
+        for (int i = 0; i < n->nchildren; i++)
+            if (n->children[i]->dirty || n->children[i]->child_dirty)
+                layout_node(l, n->children[i], &n->children[i]->rect, covered);
+    }
+    n->dirty = 0;
+    n->child_dirty = 0;
+}
+
+int layout_update(struct Layout *l){
+    if (l == NULL)
+        return 0;
+    l->relaid = 0;
+    if (l->root->dirty || l->root->child_dirty)
+        layout_node(l, l->root, &l->root->rect, 0);
+    return l->relaid;
+}
+
+void layout_clear_damage(struct Layout *l){
+    if (l != NULL)
+        l->ndamage = 0;
+}
+
+void layout_place_text(struct LayoutNode *n, void *txt){
+    struct TextView *t = txt;
+    t->x = n->rect.x;
+    t->y = n->rect.y;
+    t->width = n->rect.width;
+    t->height = n->rect.height;
+}
@@ -0,0 +1,92 @@
+#ifndef LAYOUT_H_
+#define LAYOUT_H_
+#include <limits.h>
+#include "view.h"
+
+// Layout de linhas e colunas para a arvore de views.
+// Cada no divide o seu retangulo entre os filhos no eixo principal
+// (LAYOUT_ROW: x, LAYOUT_COLUMN: y) com tamanho fixo, percentual ou flex
+// (peso do que sobra), limitado por min/max; no outro eixo o filho ocupa
+// tudo. O tamanho calculado de cada no fica guardado e o layout_update
+// so desce nos caminhos marcados por layout_invalidate/layout_set_*,
+// um no com o mesmo retangulo e sem nada marcado nao eh visitado.
+// Toda mudanca de geometria vira damage (retangulo antigo e novo).
+
+#define LAYOUT_ROW    0
+#define LAYOUT_COLUMN 1
+
+#define SIZE_FIXED    0     // size cells
+#define SIZE_PERCENT  1     // size% do espaco do pai
+#define SIZE_FLEX     2     // peso size no que sobrar
+
+#define LAYOUT_NO_MAX     INT_MAX
+#define LAYOUT_MAX_DAMAGE 32
+
+struct Layout;
+
+struct LayoutNode {
+    struct Rect rect;       // geometria calculada, coordenadas absolutas
+    int direction;          // como os filhos sao distribuidos
+    int gap, padding;
+    // tamanho no eixo principal do pai
+    int size_kind, size;
+    int min, max;
+    int measured;           // ultimo tamanho calculado no eixo do pai
+    int dirty;              // os filhos precisam ser redistribuidos
+    int child_dirty;        // algum descendente esta dirty
+    int frozen;             // usado na distribuicao dos flex
+    struct LayoutNode *parent;
+    struct LayoutNode **children;
+    int nchildren, cap;
+    struct Layout *tree;
+    // chamado quando rect muda, para posicionar a view do no
+    void (*apply)(struct LayoutNode *n, void *target);
+    void *target;
+};
+
+struct Layout {
+    struct LayoutNode *root;
+    struct Rect damage[LAYOUT_MAX_DAMAGE];
+    int ndamage;
+    int relaid;             // nos redistribuidos no ultimo layout_update
+};
+
+// Cria a arvore com a raiz ocupando width x height
+// retorna NULL em caso de erro
+struct Layout *create_layout(int width, int height, int direction);
+
+struct Layout *destroy_layout(struct Layout *l);
+
+// Adiciona um filho no fim de parent
+// retorna NULL em caso de erro
+struct LayoutNode *layout_add(struct LayoutNode *parent, int direction,
+                              int size_kind, int size);
+
+// Remove n e todos os filhos
+void layout_remove(struct LayoutNode *n);
+
+void layout_set_size(struct LayoutNode *n, int size_kind, int size);
+
+void layout_set_limits(struct LayoutNode *n, int min, int max);
+
+void layout_set_box(struct LayoutNode *n, int gap, int padding);
+
+// Liga o no a uma view, apply eh chamado sempre que rect mudar
+void layout_bind(struct LayoutNode *n,
+                 void (*apply)(struct LayoutNode *n, void *target), void *target);
+
+// Marca n para redistribuir os filhos no proximo layout_update
+void layout_invalidate(struct LayoutNode *n);
+
+// Muda o tamanho da raiz
+void layout_resize(struct Layout *l, int width, int height);
+
+// Recalcula so o que foi marcado
+// retorna quantos nos foram redistribuidos
+int layout_update(struct Layout *l);
+
+void layout_clear_damage(struct Layout *l);
+
+// apply para TextView: copia o rect para o x, y, width e height do texto
+void layout_place_text(struct LayoutNode *n, void *txt);
+#endif
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "view.h"
+#include "list_view.h"
+
+#define SELECTED_MARK '>'
+
+struct ListView *create_list(int width, int height, int x, int y,
+                             long rows, RowProvider provider, void *ctx)
+{
+    struct ListView *lst;
+    if (width < 2 || height < 1 || provider == NULL)
+        return NULL;
+
+    if ((lst = calloc(1, sizeof(struct ListView))) == NULL)
+        return NULL;
+
+    lst->width = width;
+    lst->height = height;
+    lst->x = x;
+    lst->y = y;
+    lst->rows = rows < 0 ? 0 : rows;
+    lst->top = 0;
+    lst->selected = LIST_NO_SELECTION;
+    lst->sep = '|';
+    lst->bg = ' ';
+    lst->provider = provider;
+    lst->ctx = ctx;
+    lst->ncols = 1;
+    // primeira coluna eh o marcador de selecao
+    lst->col_widths[0] = width - 1;
+
+    lst->cache_sz = height + 2 * LIST_PREFETCH;
+    lst->cache_row = malloc(sizeof(long) * lst->cache_sz);
+    lst->cache = malloc(sizeof(char) * lst->cache_sz * width);
+    if (lst->cache_row == NULL || lst->cache == NULL)
+        return destroy_list(lst);
+    list_invalidate(lst, -1);
+
+    return lst;
+}
+
+struct ListView *destroy_list(struct ListView *lst){
+    if (lst == NULL)
+        return NULL;
+    free(lst->cache_row);
+    free(lst->cache);
+    free(lst);
+
+    return NULL;
+}
+
+int list_set_columns(struct ListView *lst, int ncols, const int *widths){
+    int used = 0;
+    if (lst == NULL || ncols < 1 || ncols > LIST_MAX_COLS)
+        return -1;
+
+    // largura total: marcador + colunas + separadores
+    for (int i = 0; i < ncols; i++){
+        lst->col_widths[i] = widths[i] < 0 ? 0 : widths[i];
+        if (i == ncols - 1)
+            lst->col_widths[i] = (lst->width - 1) - used;
+        clamp_int(&lst->col_widths[i], 0, lst->width - 1 - used);
+        used += lst->col_widths[i] + 1;
+    }
+    lst->ncols = ncols;
+    list_invalidate(lst, -1);
+    return 0;
+}
+
+int list_resize(struct ListView *lst, int width, int height){
+    long *rows;
+    char *cache;
+    int sz;
+    if (lst == NULL || width < 2 || height < 1)
+        return -1;
+    if (lst->width == width && lst->height == height)
+        return 0;
+
+    sz = height + 2 * LIST_PREFETCH;
+    if ((rows = malloc(sizeof(long) * sz)) == NULL)
+        return -1;
+    if ((cache = malloc(sizeof(char) * sz * width)) == NULL){
+        free(rows);
+        return -1;
+    }
+    free(lst->cache_row);
+    free(lst->cache);
+    lst->cache_row = rows;
+    lst->cache = cache;
+    lst->cache_sz = sz;
+    lst->width = width;
+    lst->height = height;
+    // a ultima coluna acompanha a largura nova, tambem invalida o cache
+    list_set_columns(lst, lst->ncols, lst->col_widths);
+    list_jump(lst, lst->top);
+
+    return 0;
+}
+
+void list_set_rows(struct ListView *lst, long rows){
+    if (lst == NULL)
+        return;
+    lst->rows = rows < 0 ? 0 : rows;
+    if (lst->selected >= lst->rows)
+        lst->selected = LIST_NO_SELECTION;
+    list_jump(lst, lst->top);
+    list_invalidate(lst, -1);
+}
+
+void list_invalidate(struct ListView *lst, long row){
+    if (lst == NULL)
+        return;
+    if (row < 0){
+        for (int i = 0; i < lst->cache_sz; i++)
+            lst->cache_row[i] = -1;
+    }else if (lst->cache_row[row % lst->cache_sz] == row){
+        lst->cache_row[row % lst->cache_sz] = -1;
+    }
+}
+
+void list_jump(struct ListView *lst, long row){
+    long max_top;
+    if (lst == NULL)
+        return;
+    if (row < lst->top)
+        lst->top = row;
+    else if (row >= lst->top + lst->height)
+        lst->top = row - lst->height + 1;
+
+    max_top = lst->rows - lst->height;
+    if (lst->top > max_top)
+        lst->top = max_top;
+    if (lst->top < 0)
+        lst->top = 0;
+}
+
+void list_scroll(struct ListView *lst, long delta){
+    if (lst == NULL)
+        return;
+    // joga a linha de referencia para fora da tela na direcao do scroll
+    if (delta < 0)
+        list_jump(lst, lst->top + delta);
+    else if (delta > 0)
+        list_jump(lst, lst->top + lst->height - 1 + delta);
+}
+
+void list_select(struct ListView *lst, long row){
+    if (lst == NULL)
+        return;
+    if (row < 0 || row >= lst->rows){
+        lst->selected = LIST_NO_SELECTION;
+        return;
+    }
+    lst->selected = row;
+    list_jump(lst, row);
+}
+
+long list_row_at(struct ListView *lst, int y){
+    long row;
+    if (lst == NULL || !in_range(y, 0, lst->height - 1))
+        return -1;
+    row = lst->top + y;
+    return row < lst->rows ? row : -1;
+}
+
+// Formata a linha no slot do cache e retorna o texto
+static char *fetch_row(struct ListView *lst, long row){
+    int slot = row % lst->cache_sz;
+    int off = 1, n, w;
+    char *line = &lst->cache[slot * lst->width];
+
+    if (lst->cache_row[slot] == row)
+        return line;
+
+    memset(line, ' ', lst->width);
+    for (int c = 0; c < lst->ncols && off < lst->width; c++){
+        w = lst->col_widths[c];
+        if (off + w > lst->width)
+            w = lst->width - off;
+        n = lst->provider(row, c, &line[off], w, lst->ctx);
+        if (n < 0)
+            n = 0;
+        if (n > w)
+            n = w;
+        // o provider pode escrever qualquer coisa, limpa o que nao imprime
+        for (int i = 0; i < n; i++)
+            if (!is_printable_char(line[off + i]))
+                line[off + i] = '?';
+        for (int i = n; i < w; i++)
+            line[off + i] = ' ';
+        off += w;
+        if (c != lst->ncols - 1 && off < lst->width)
+            line[off++] = lst->sep;
+    }
+    lst->cache_row[slot] = row;
+
+    return line;
+}
+
+int render_list_to_view(struct ListView *lst, struct BaseView *vw){
+    long row, first, last;
+    char *line;
+    if (lst == NULL || vw == NULL)
+        return -1;
+
+    first = lst->top - LIST_PREFETCH;
+    last = lst->top + lst->height + LIST_PREFETCH;
+    if (first < 0)
+        first = 0;
+    if (last > lst->rows)
+        last = lst->rows;
+    // prefetch: deixa as linhas vizinhas prontas para o proximo scroll
+    for (row = first; row < lst->top; row++)
+        fetch_row(lst, row);
+    for (row = lst->top + lst->height; row < last; row++)
+        fetch_row(lst, row);
+
+    for (int i = 0; i < lst->height; i++){
+        row = lst->top + i;
+        if (row >= lst->rows){
+            for (int j = 0; j < lst->width; j++)
+                set_value(vw, lst->x + j, lst->y + i, lst->bg);
+            continue;
+        }
+        line = fetch_row(lst, row);
+        line[0] = row == lst->selected ? SELECTED_MARK : ' ';
+        print_to_view(vw, lst->x, lst->y + i, lst->width, line);
+    }
+
+    return 0;
+}
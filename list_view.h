@@ -0,0 +1,66 @@
+#ifndef LIST_VIEW_H_
+#define LIST_VIEW_H_
+#include "view.h"
+
+// Lista/tabela virtual: as linhas nao ficam em memoria, sao pedidas
+// para o provider apenas quando ficam visiveis (mais LIST_PREFETCH acima
+// e abaixo) e o texto formatado fica em um cache do tamanho da tela.
+
+#define LIST_PREFETCH 8
+#define LIST_MAX_COLS 16
+#define LIST_NO_SELECTION (-1)
+
+// Escreve o texto da celula (row, col) em buf, no maximo sz chars
+// retorna quantos chars escreveu, -1 se a linha nao existe
+typedef int (*RowProvider)(long row, int col, char *buf, int sz, void *ctx);
+
+struct ListView {
+    POSTYPE;
+    long rows;          // total de linhas do dataset
+    long top;           // primeira linha visivel
+    long selected;
+    int ncols;
+    int col_widths[LIST_MAX_COLS];
+    char sep;           // separador entre colunas
+    char bg;
+    RowProvider provider;
+    void *ctx;
+    // cache, o slot de uma linha eh row % cache_sz
+    int cache_sz;
+    long *cache_row;    // linha guardada em cada slot, -1 se vazio
+    char *cache;        // cache_sz * width chars
+};
+
+struct ListView *create_list(int width, int height, int x, int y,
+                             long rows, RowProvider provider, void *ctx);
+
+struct ListView *destroy_list(struct ListView *lst);
+
+// Define as colunas, a ultima coluna ocupa o que sobrar da largura
+// retorna -1 se ncols for invalido
+int list_set_columns(struct ListView *lst, int ncols, const int *widths);
+
+// Muda o tamanho da lista na tela, refaz o cache e a ultima coluna
+// retorna -1 em caso de erro (a lista continua como estava)
+int list_resize(struct ListView *lst, int width, int height);
+
+// Muda o tamanho do dataset, invalida o cache
+void list_set_rows(struct ListView *lst, long rows);
+
+// Descarta a linha do cache, row < 0 descarta tudo
+void list_invalidate(struct ListView *lst, long row);
+
+// Move a janela para que row fique visivel, O(1)
+void list_jump(struct ListView *lst, long row);
+
+void list_scroll(struct ListView *lst, long delta);
+
+void list_select(struct ListView *lst, long row);
+
+// retorna a linha na posicao y relativa a lst, -1 se nao tiver
+long list_row_at(struct ListView *lst, int y);
+
+// Desenha as linhas visiveis em vw
+// retorna -1 se tiver erro
+int render_list_to_view(struct ListView *lst, struct BaseView *vw);
+#endif
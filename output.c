@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "trace.h"
+#include "view.h"
+#include "output.h"
+
+// Abre um fd de escrita nao bloqueante para o mesmo arquivo de fd.
+// Para tty abre o device de novo, assim O_NONBLOCK fica so nessa open file
+// description e nao afeta o stdin nem o shell que compartilham o stdout.
+static int open_nonblock(struct Output *o, int fd){
+    const char *tty;
+    int nfd;
+
+    o->orig_fd = fd;
+    o->orig_flags = -1;
+    if (isatty(fd) && (tty = ttyname(fd)) != NULL &&
+        (nfd = open(tty, O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)) != -1)
+        return nfd;
+
+    // pipe, socket, arquivo: muda as flags e restaura no close
+    if ((o->orig_flags = fcntl(fd, F_GETFL)) == -1)
+        return -1;
+    if (fcntl(fd, F_SETFL, o->orig_flags | O_NONBLOCK) == -1){
+        o->orig_flags = -1;
+        return -1;
+    }
+    return fd;
+}
+
+struct Output *output_open(int fd, int width, int height){
+    struct Output *o = calloc(1, sizeof(struct Output));
+    if (o == NULL)
+        return NULL;
+
+    // o que o stdio ainda tem no buffer tem que sair antes dos frames
+    fflush(stdout);
+    if ((o->fd = open_nonblock(o, fd)) == -1){
+        free(o);
+        return NULL;
+    }
+    if (output_resize(o, width, height) == -1)
+        return output_close(o);
+
+    return o;
+}
+
+struct Output *output_close(struct Output *o){
+    int flags;
+    if (o == NULL)
+        return NULL;
+
+    // o resto sai bloqueando, senao a tela fica pela metade
+    if ((flags = fcntl(o->fd, F_GETFL)) != -1)
+        fcntl(o->fd, F_SETFL, flags & ~O_NONBLOCK);
+    output_flush(o);
+
+    if (o->fd != o->orig_fd)
+        close(o->fd);
+    else if (o->orig_flags != -1)
+        fcntl(o->orig_fd, F_SETFL, o->orig_flags);
+    if (o->front != NULL)
+        destroy_view(o->front);
+    outbuf_free(&o->out);
+    free(o);
+
+    return NULL;
+}
+
+long output_flush(struct Output *o){
+    ssize_t w;
+    if (o == NULL)
+        return -1;
+
+    while (o->out_off < o->out.len){
+        w = write(o->fd, o->out.data + o->out_off, o->out.len - o->out_off);
+        TRACE_COUNT(TRACE_SYSCALLS, 1);
+        if (w == -1){
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return -1;
+            break;
+        }
+        o->out_off += w;
+        TRACE(TRACE_BYTES_WRITTEN, w);
+    }
+    if (o->out_off == o->out.len){
+        o->out.len = 0;
+        o->out_off = 0;
+    }
+
+    return o->out.len - o->out_off;
+}
+
+int output_congested(struct Output *o){
+    int queued;
+    if (o == NULL)
+        return 0;
+    // o frame anterior ainda nao saiu do programa
+    if (o->out.len > o->out_off)
+        return 1;
+    // ja saiu mas esta parado na fila do tty (so funciona em tty/socket)
+    if (ioctl(o->fd, TIOCOUTQ, &queued) == 0 && queued > OUTPUT_MAX_QUEUED)
+        return 1;
+    return 0;
+}
+
+int output_present(struct Output *o, struct BaseView *frame){
+    return output_present_rects(o, frame, NULL, -1);
+}
+
+int output_present_rects(struct Output *o, struct BaseView *frame,
+                         const struct Rect *rects, int nrects)
+{
+    int n;
+    if (o == NULL || frame == NULL)
+        return -1;
+
+    if (output_flush(o) == -1)
+        return -1;
+    // descarta o frame, o front continua sendo o que o terminal vai mostrar
+    // e o proximo frame enviado leva todas as mudancas de uma vez
+    if (output_congested(o)){
+        o->behind = 1;
+        o->dropped++;
+        TRACE(TRACE_FRAMES_DROPPED, 1);
+        return 0;
+    }
+
+    // front invalido ou frame descartado antes: as mudancas que faltam
+    // no terminal podem estar fora dos retangulos, vai tudo
+    if (nrects < 0 || o->behind || o->invalid)
+        n = diff_view(o->front, frame, &o->out);
+    else
+        n = diff_view_rects(o->front, frame, rects, nrects, &o->out);
+    if (n == -1)
+        return -1;
+    o->behind = 0;
+    o->invalid = 0;
+    if (output_flush(o) == -1)
+        return -1;
+
+    return 1;
+}
+
+int output_wait(struct Output *o, int fd, int timeout_ms){
+    struct pollfd pfd[2];
+    if (o == NULL)
+        return 0;
+
+    pfd[0].fd = o->fd;
+    // sem saida pendente o poll so dorme ate o timeout
+    pfd[0].events = o->out.len > o->out_off ? POLLOUT : 0;
+    pfd[0].revents = 0;
+    pfd[1].fd = fd;
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
+    TRACE_COUNT(TRACE_SYSCALLS, 1);
+    if (poll(pfd, fd == -1 ? 1 : 2, timeout_ms) <= 0)
+        return 0;
+
+    return fd != -1 && (pfd[1].revents & POLLIN);
+}
+
+// Escreve os n bytes mesmo com o fd nao bloqueante
+static int write_all(int fd, const char *buf, size_t n){
+    struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+    ssize_t w;
+    while (n > 0){
+        w = write(fd, buf, n);
+        TRACE_COUNT(TRACE_SYSCALLS, 1);
+        if (w == -1){
+            if (errno == EAGAIN || errno == EWOULDBLOCK){
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += w;
+        n -= w;
+        TRACE(TRACE_BYTES_WRITTEN, w);
+    }
+    return 0;
+}
+
+int output_suspend(struct Output *o, const char *seq, size_t n){
+    if (o == NULL)
+        return -1;
+
+    // o que ainda nao foi mostrado eh refeito pelo output_repaint,
+    // descartar deixa o ctrl-z instantaneo mesmo com o terminal atrasado
+    o->out.len = 0;
+    o->out_off = 0;
+    if (isatty(o->fd))
+        tcflush(o->fd, TCOFLUSH);
+
+    // o corte pode ter parado no meio de uma sequencia de escape, o CAN
+    // faz o terminal abandonar a sequencia antes de ler seq
+    if (write_all(o->fd, OUTPUT_CAN, 1) == -1)
+        return -1;
+    return write_all(o->fd, seq, n);
+}
+
+int output_repaint(struct Output *o, const char *prefix, size_t n){
+    char seq[32], *row;
+    int len;
+    if (o == NULL || o->front == NULL)
+        return -1;
+
+    o->out.len = 0;
+    o->out_off = 0;
+    if (outbuf_append(&o->out, prefix, n) == -1)
+        return -1;
+    if (o->invalid)
+        return output_flush(o) == -1 ? -1 : 0;
+    for (int y = 0; y < o->front->height; y++){
+        if ((row = view_row_mut(o->front, y)) == NULL)
+            return -1;
+        // cell invalidado vai como espaco, igual ao diff_view
+        for (int x = 0; x < o->front->width; x++)
+            if (CELL_CHAR(row[x]) == TRANSPARENT_PIXEL)
+                row[x] |= ' ';
+        len = snprintf(seq, sizeof(seq), "\x1b[%d;1H", y + 1);
+        if (outbuf_append(&o->out, seq, len) == -1 ||
+            outbuf_append_cells(&o->out, row, o->front->width) == -1)
+            return -1;
+    }
+    TRACE(TRACE_CELLS_EMITTED, o->front->width * o->front->height);
+    o->behind = 0;
+
+    return output_flush(o) == -1 ? -1 : 0;
+}
+
+void output_invalidate(struct Output *o){
+    // TRANSPARENT_PIXEL nunca eh enviado, entao todo cell fica diferente
+    if (o != NULL && o->front != NULL){
+        fill_view(o->front, TRANSPARENT_PIXEL);
+        o->invalid = 1;
+    }
+}
+
+int output_resize(struct Output *o, int width, int height){
+    struct BaseView *vw;
+    if (o == NULL || width <= 0 || height <= 0)
+        return -1;
+    if ((vw = create_view(width, height, 0, 0)) == NULL)
+        return -1;
+    if (o->front != NULL)
+        destroy_view(o->front);
+    o->front = vw;
+    output_invalidate(o);
+
+    return 0;
+}
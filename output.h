@@ -0,0 +1,82 @@
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+#include <stddef.h>
+#include "view.h"
+
+// Escrita nao bloqueante no terminal com deteccao de backpressure.
+// Quando o terminal (ou o link ssh) nao da conta, write bloquearia ou os
+// frames se acumulariam no kernel e a tela ficaria segundos atrasada.
+// Aqui o frame so eh enviado se a saida anterior ja saiu do programa e a
+// fila do tty (TIOCOUTQ) esta pequena; senao o frame eh descartado. O
+// front guarda o que o terminal vai mostrar quando a fila esvaziar, entao
+// o proximo frame enviado eh o diff do mais novo contra ele.
+
+// Bytes na fila do tty acima dos quais o terminal esta atrasado
+#define OUTPUT_MAX_QUEUED (8 * 1024)
+// Cancela a sequencia de escape que o terminal estiver lendo
+#define OUTPUT_CAN "\x18"
+
+struct Output {
+    int fd;                 // fd de escrita, O_NONBLOCK
+    int orig_fd;            // fd recebido em output_open
+    int orig_flags;         // flags de orig_fd para restaurar, -1 se nao mudou
+    struct BaseView *front; // o que o terminal recebeu
+    struct OutBuf out;      // saida pendente
+    size_t out_off;         // quanto de out ja foi escrito
+    int behind;             // ultimo frame foi descartado
+    int invalid;            // front invalidado, o proximo frame vai inteiro
+    long dropped;           // frames descartados
+};
+
+// Abre a saida em fd com um front de width x height
+// retorna NULL em caso de erro
+struct Output *output_open(int fd, int width, int height);
+
+// Termina de escrever a saida pendente (bloqueando) e restaura o fd
+struct Output *output_close(struct Output *o);
+
+// Faz o diff de frame contra o front e escreve o que der sem bloquear.
+// Se o terminal estiver atrasado o frame eh descartado
+// retorna 1 se o frame foi enviado, 0 se foi descartado, -1 se tiver erro
+int output_present(struct Output *o, struct BaseView *frame);
+
+// output_present comparando so os retangulos que mudaram em frame desde o
+// ultimo present; nrects < 0 compara tudo. Depois de um frame descartado
+// ou de invalidar o front o diff eh feito no frame inteiro
+// retorna 1 se o frame foi enviado, 0 se foi descartado, -1 se tiver erro
+int output_present_rects(struct Output *o, struct BaseView *frame,
+                         const struct Rect *rects, int nrects);
+
+// Escreve o maximo possivel da saida pendente sem bloquear
+// retorna quantos bytes ainda estao pendentes, -1 se tiver erro
+long output_flush(struct Output *o);
+
+// retorna 1 se o proximo output_present vai ser descartado
+int output_congested(struct Output *o);
+
+// Espera ate timeout_ms, ate a saida pendente poder ser escrita ou ate
+// fd ter dados para ler (-1 ignora)
+// retorna 1 se fd tem dados
+int output_wait(struct Output *o, int fd, int timeout_ms);
+
+// Descarta a saida pendente (inclusive a fila do tty) e escreve seq
+// inteira precedida de OUTPUT_CAN, ja que o descarte pode ter cortado uma
+// sequencia no meio. Usado para devolver o terminal antes de suspender.
+// O front continua valendo, ver output_repaint
+// retorna -1 em caso de erro
+int output_suspend(struct Output *o, const char *seq, size_t n);
+
+// Reescreve a tela inteira a partir do front em um unico write,
+// comecando por prefix (sequencias para voltar ao modo da aplicacao).
+// Se o front foi invalidado (output_resize, output_invalidate) so escreve
+// prefix: o proximo output_present ja desenha a tela inteira
+// retorna -1 em caso de erro
+int output_repaint(struct Output *o, const char *prefix, size_t n);
+
+// Redesenha a tela inteira no proximo present
+void output_invalidate(struct Output *o);
+
+// Muda o tamanho do front, a tela eh redesenhada no proximo present
+// retorna -1 em caso de erro
+int output_resize(struct Output *o, int width, int height);
+#endif
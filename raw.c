@@ -5,9 +5,24 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <signal.h>
+#include <poll.h>
 #include "raw.h"
+#include "trace.h"
+#include "record.h"
+#include "timer.h"
+#include "signals.h"
+#include "view.h"
+#include "hit.h"
 
 static struct globalConfig G;
+// signalfd com SIGINT, SIGTSTP, SIGCONT e SIGWINCH, -1 se nao foi aberto
+static int sigFd = -1;
+// retangulos desenhados com o mouse, para o hover
+static struct HitGrid *hitGrid = NULL;
+// ids dos ultimos MAX_RECTS retangulos, o mais antigo sai quando enche
+#define MAX_RECTS 32
+static int rects[MAX_RECTS];
+static int nRects = 0, oldestRect = 0;
 
 void setRawTerminal(){
     // refence: https://viewsourcecode.org/snaptoken/kilo/02.enteringRawMode.html
@@ -151,26 +166,69 @@ void pushEvent(int event){
     eventHead = MOD_INC(eventHead, MAX_EVENT);
 }
 
-static int getInput(int *index){
+static ssize_t stdinRead(void *buf, size_t sz){
+    TRACE_COUNT(TRACE_SYSCALLS, 1);
+    return read(STDINF, buf, sz);
+}
+
+static ssize_t (*inputRead)(void *buf, size_t sz) = stdinRead;
+
+void setInputSource(ssize_t (*source)(void *buf, size_t sz)){
+    inputRead = source == NULL ? stdinRead : source;
+}
+
+// Lote: os bytes lidos desde que o eventBuffer estava vazio ate acabar o
+// input. O tempo de parse e os bytes vao para o trace uma vez por lote,
+// o relogio por evento custava mais que o proprio parse
+static int inputBytes = 0;
+static uint64_t batchStart = 0;
+
+// Le um byte do input para o eventBuffer
+// retorna 0 se nao tinha nada para ler
+static int readInput(){
     char c = '\0';
-    if (eventCurr == eventHead){
-        if (read(STDINF, &c, 1) == -1)
-            KILL("%s", "Erro lendo input (read)");
-        // evitar que o buffer fique enchendo de NOKEY
-        if (c =='\0')
-            return 0;
-        eventBuffer[eventHead] = c;
-        eventHead = MOD_INC(eventHead, MAX_EVENT);
-    }
+    ssize_t n;
+    if ((n = inputRead(&c, 1)) == -1)
+        KILL("%s", "Erro lendo input (read)");
+    if (n > 0)
+        record_bytes(&c, 1);
+    else
+        record_boundary();
+    // evitar que o buffer fique enchendo de NOKEY
+    if (c =='\0')
+        return 0;
+    inputBytes++;
+    eventBuffer[eventHead] = c;
+    eventHead = MOD_INC(eventHead, MAX_EVENT);
+    return 1;
+}
+
+static int getInput(int *index){
+    if (eventCurr == eventHead && !readInput())
+        return 0;
 
     *index = eventCurr;
     eventCurr = MOD_INC(eventCurr, MAX_EVENT);
     return 1;
 }
 
+int waitInput(int timeout_ms){
+    // o signalfd tambem acorda o poll, os sinais sao lidos por quem chamou
+    struct pollfd pfd[2] = {
+        {.fd = STDINF, .events = POLLIN},
+        {.fd = sigFd, .events = POLLIN},
+    };
+    int r;
+    r = poll(pfd, sigFd == -1 ? 1 : 2, timeout_ms);
+    TRACE_COUNT(TRACE_SYSCALLS, 1);
+    if (r == -1 && errno != EINTR)
+        KILL("%s", "Erro esperando input (poll)");
+    return r > 0 && (pfd[0].revents & POLLIN);
+}
+
 // TODO: implementar melhor forma de retornar, usando eventos
 // TODO: implementar sistema de push de eventos
-int getEvent(struct Event *event){
+static int parseEvent(struct Event *event){
     char str[100] = {0};
     int bProps, counter = 0, index = 0, savedIndex;
     int funcNum = 0, mod, funcKey;
@@ -327,93 +385,248 @@ int getEvent(struct Event *event){
     return eventBuffer[index];
 }
 
+int getEvent(struct Event *event){
+    if (eventCurr == eventHead){
+        // o relogio so eh lido quando chega um byte, NOKEY sem nada
+        // pendente nao custa nada ao trace
+        if (inputBytes == 0 && readInput())
+            TRACE_MARK(batchStart);
+        else if (inputBytes > 0 && !readInput()){
+            // fim do lote, inclui o que quem chamou fez entre os eventos
+            TRACE_SINCE(TRACE_PARSE_NS, batchStart);
+            TRACE_COUNT(TRACE_INPUT_BYTES, inputBytes);
+            inputBytes = 0;
+            return NOKEY;
+        }
+        if (eventCurr == eventHead)
+            return NOKEY;
+    }
+    return parseEvent(event);
+}
+
+// Escritas de uma vez so ao suspender e ao voltar
+#define RAW_RESTORE ESC"[?1003l"ESC"[?1002l"ESC"[?1006l"ESC"[?25h"ESC"[?1049l"
+#define RAW_SETUP   ESC"[?1049h"ESC"[?1003h"ESC"[?1006h"
+
+static void resumeRaw(){
+    if (tcsetattr(STDINF, TCSANOW, &G.rawTerm) == -1)
+        KILL("%s", "Erro ao colocar terminal no modo G.rawTerm");
+    if (write(STDOUTF, RAW_SETUP, sizeof(RAW_SETUP) - 1) != sizeof(RAW_SETUP) - 1)
+        KILL("%s", "Nao foi possivel voltar para o buffer alternativo");
+    moveCursor(G.x, G.y);
+}
+
+// ctrl-z: devolve o terminal em um write e para, a volta para o modo raw
+// fica com quem trata o SIGNAL_CONT (resumeRaw)
+// retorna os sinais que chegaram enquanto estava parado, mais SIGNAL_CONT
+static int suspendRaw(){
+    int got;
+    fflush(stdout);
+    // o que ainda esta na fila do tty nao precisa sair antes do shell voltar
+    tcflush(STDOUTF, TCOFLUSH);
+    if (write(STDOUTF, RAW_RESTORE, sizeof(RAW_RESTORE) - 1) != sizeof(RAW_RESTORE) - 1)
+        KILL("%s", "Nao foi possivel restaurar o terminal");
+    if (tcsetattr(STDINF, TCSANOW, &G.savedTerm) == -1)
+        KILL("%s", "Erro ao restaurar o terminal");
+
+    got = signals_stop(sigFd);
+
+    return got | SIGNAL_CONT;
+}
+
+#define EXIT_MSG "TERMAL - Clique qualquer tecla para sair"
+
+// Desenha o prompt de saida no centro da tela, ou da area do G se inBox
+static void showExitMsg(int inBox, int clear){
+    int x = G.width / 2 - (int)sizeof(EXIT_MSG) / 2, y = G.height / 2;
+    if (inBox){
+        x += G.x;
+        y += G.y;
+    }
+    clearScreen(clear);
+    moveCursor(x, y);
+    printf("%s\n", EXIT_MSG);
+    fflush(stdout);
+}
+
+// Espera uma tecla no prompt de saida. Os sinais continuam sendo lidos,
+// senao o sigFd fica sempre pronto e o poll nao dorme: ctrl-c sai,
+// ctrl-z suspende, e na volta ou depois de um resize o prompt eh
+// desenhado de novo no tamanho atual
+static void waitExitKey(int inBox){
+    int got;
+    while (getEvent(NULL) == NOKEY){
+        waitInput(-1);
+        got = signals_read(sigFd);
+        if (got & SIGNAL_INT)
+            EXIT;
+        if (got & SIGNAL_TSTP)
+            got |= suspendRaw();
+        if (got & SIGNAL_WINCH){
+            getTerminalSize(&G.width, &G.height);
+            hit_resize(hitGrid, G.width, G.height);
+        }
+        if (got & SIGNAL_CONT){
+            resumeRaw();
+            setMouseEvents(MOUSE_BUTTON);
+        }
+        if (got & (SIGNAL_WINCH | SIGNAL_CONT))
+            showExitMsg(inBox, FULL);
+    }
+}
+
 void exit_termal(int a){
     (void)a;
-    char msg[] = "TERMAL - Clique qualquer tecla para sair";
-    size_t msg_sz = sizeof(msg);
-    clearScreen(FULL);
-    moveCursor(G.width / 2 - msg_sz / 2, G.height / 2);
-    printf("%s\n", msg);
+    showExitMsg(0, FULL);
     setMouseEvents(MOUSE_BUTTON);
-    while(getEvent(NULL) == NOKEY);
+    waitExitKey(0);
     EXIT;
 }
 
 void exit_raw(int s){
     (void)s;
-    char msg[] = "TERMAL - Clique qualquer tecla para sair";
-    size_t msg_sz = sizeof(msg);
-    clearScreen(CURTOEND);
-    moveCursor(G.x + G.width / 2 - msg_sz / 2, G.y + G.height / 2);
-    printf("%s\n", msg);
+    showExitMsg(1, CURTOEND);
     setMouseEvents(MOUSE_BUTTON);
-    while(getEvent(NULL) == NOKEY);
+    waitExitKey(1);
     EXIT;
 }
 
-// TODO: jeito de recuperar screen depois de SIGTSTP
-/* void sigStpHandler(int s){
-    (void)s;
-    resetTerminal();
-    SEND("%s", ESC"[?47h");
-    struct sigaction sa;
-    sa.sa_handler = SIG_DFL;
-    sigemptyset(&sa.sa_mask);
-    if (sigaction(SIGTSTP, &sa, NULL) == -1)
-        KILL("%s", "Definindo a funcao para manipular o SIGTSTP");
-    raise(s);
+static void handleSignals(){
+    int got = signals_read(sigFd);
+    if (got & SIGNAL_TSTP)
+        got |= suspendRaw();
+    // o tamanho primeiro: pode ter mudado enquanto estava parado
+    if (got & SIGNAL_WINCH){
+        getTerminalSize(&G.width, &G.height);
+        hit_resize(hitGrid, G.width, G.height);
+    }
+    // SIGCONT, do ctrl-z ou de alguem que mandou SIGSTOP: o tty pode ter mudado
+    if (got & SIGNAL_CONT)
+        resumeRaw();
+    if (got & SIGNAL_INT)
+        exit_raw(0);
 }
 
-void sigContHandler(int s){
-    (void)s;
-    struct sigaction sa;
-    sa.sa_handler = sigStpHandler;
-    sigemptyset(&sa.sa_mask);
-    if (sigaction(SIGTSTP, &sa, NULL) == -1)
-        KILL("%s", "Definindo a funcao para manipular o SIGTSTP");
-    sa.sa_handler = sigContHandler;
-    sigemptyset(&sa.sa_mask);
-    if (sigaction(SIGCONT, &sa, NULL) == -1)
-        KILL("%s", "Definindo a funcao para manipular o SIGONT");
+// Passa a captura pelo parser e mostra o custo
+// retorna 0 se deu certo
+static int replayCapture(const char *path, int mode){
+    struct Capture cap;
+    struct Event event;
+    long events = 0, loneEsc = 0;
+    uint64_t start, elapsed;
+    double secs;
+    int c;
 
+    if (capture_load(path, &cap) == -1){
+        PERRO("Nao foi possivel carregar a captura %s", path);
+        return 1;
+    }
+    replay_start(&cap, mode);
+    setInputSource(replay_read);
 
-    if (tcsetattr(STDINF, TCSAFLUSH, &G.rawTerm) == -1)
-        KILL("%s", "Erro ao colocar terminal no modo G.rawTerm");
-    setMouseEvents(MOUSE_BUTTON);
-    enterBuffer();
-    SEND("%s", ESC"[?47l");
-} */
+    start = trace_now();
+    // continua enquanto tiver bytes no eventBuffer que voltaram por backtrack
+    while (!replay_done() || eventCurr != eventHead){
+        c = getEvent(&event);
+        if (c == NOKEY)
+            continue;
+        events++;
+        // ESC sozinho normalmente eh uma sequencia quebrada entre reads
+        if (c == *ESC)
+            loneEsc++;
+    }
+    elapsed = trace_now() - start;
+    secs = elapsed / 1e9;
+
+    printf("%s: %zu bytes, %zu reads, %ld eventos, %ld ESC soltos\n",
+            path, cap.bytes, cap.nchunks, events, loneEsc);
+    printf("    %.3f ms, %.0f eventos/s, %.2f ns/byte\n",
+            secs * 1e3,
+            secs > 0 ? events / secs : 0.0,
+            cap.bytes > 0 ? (double)elapsed / cap.bytes : 0.0);
+
+    setInputSource(NULL);
+    capture_free(&cap);
+    return 0;
+}
 
-int main(){
+static void usage(const char *prog){
+    fprintf(stderr, "uso: %s [-r arquivo.cap] [-p arquivo.cap] [-P arquivo.cap]\n", prog);
+    fprintf(stderr, "    -r  grava o stdin em arquivo.cap\n");
+    fprintf(stderr, "    -p  reproduz a captura na velocidade maxima\n");
+    fprintf(stderr, "    -P  reproduz a captura em tempo real\n");
+}
+
+static void loopTick(struct Timer *t, void *arg){
+    (void)t;
+    SEND("\r%d", (*(int *)arg)++);
+}
+
+int main(int argc, char **argv){
     int c;
-    int quit = 0, lopping = 0, i = 0;
+    int quit = 0, i = 0;
     struct Event event;
+    struct Rect rect;
+    int slot;
+    struct TimerWheel wheel;
+    struct Timer loopTimer = {0};
+
+    while ((c = getopt(argc, argv, "r:p:P:")) != -1){
+        switch (c){
+            case 'r':
+                if (record_open(optarg) == -1){
+                    PERRO("Nao foi possivel criar %s", optarg);
+                    return 1;
+                }
+                atexit(record_close);
+                break;
+            case 'p': return replayCapture(optarg, REPLAY_FAST);
+            case 'P': return replayCapture(optarg, REPLAY_REALTIME);
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
 
     if (!isatty(STDINF))
         KILL("%s", "A entrada nao eh um terminal");
     if (!isatty(STDOUTF))
         KILL("%s", "A saida nao eh um terminal");
 
-    setSigIntHandler(exit_raw);
+    if ((sigFd = signals_open()) == -1)
+        KILL("%s", "Criando o signalfd");
+    trace_dump_on_exit(TRACE_FILE);
+    if (trace_dump_on_signal(SIGUSR1, TRACE_FILE) == -1)
+        KILL("%s", "Definindo a funcao para manipular o SIGUSR1");
     setRawTerminal();
     // getCursorPos(&G.x, &G.y);
 
-    setMouseEvents(MOUSE_BUTTON);
+    // MOUSE_ALL: movimento sem botao tambem gera evento, para o hover
+    setMouseEvents(MOUSE_ALL);
     enterBuffer();
     G.x = 1; G.y = 1;
     getTerminalSize(&G.width, &G.height);
+    if ((hitGrid = create_hit_grid(G.width, G.height)) == NULL)
+        KILL("%s", "Criando a grade de hit-test");
     moveCursor(G.x, G.y);
 
+    timer_init(&wheel, timer_now_ms());
     while (!quit){
         c = getEvent(&event);
-        if (lopping && c != NOKEY){
+        if (timer_pending(&loopTimer) && c != NOKEY){
             i = 0;
-            lopping = !lopping;
+            timer_cancel(&wheel, &loopTimer);
         }
         switch (c){
             case NOKEY:
-                if (lopping)
-                    SEND("\r%d", i++);
+                // o input acabou, resolve so a ultima posicao do mouse
+                if (hit_hover_update(hitGrid))
+                    SEND(ESC"7"ESC"[1;1H"ESC"[2Khover: %d"ESC"8", hitGrid->hover);
+                // dorme ate chegar input ou o proximo timer vencer
+                timer_advance(&wheel, timer_now_ms());
+                waitInput(timer_timeout(&wheel, timer_now_ms()));
+                handleSignals();
+                timer_advance(&wheel, timer_now_ms());
                 break;
             case CTRL_KEY('q'):
                 exit_termal(0);
@@ -424,7 +637,7 @@ int main(){
                 break;
             case 'r':
                 getCursorPos(NULL, NULL);
-                lopping = 1;
+                timer_start(&wheel, &loopTimer, LOOP_MS, LOOP_MS, loopTick, &i);
                 break;
             case ARROW_UP:
             case ARROW_DOWN:
@@ -433,11 +646,33 @@ int main(){
                 printf("Arrow pressed\r\n");
                 break;
             case MOUSE:
-                if (event.button == B1 && event.action == B_PRESSED){
+                // coordenadas do mouse comecam em 1, as da grade em 0
+                // so o movimento sem botao vai para o hover, arrastar com o
+                // B1 apertado continua desenhando
+                if (event.motion && !event.scroll && event.button == B_NONE){
+                    hit_motion(hitGrid, event.x - 1, event.y - 1);
+                }else if (event.button == B1 && event.action == B_PRESSED){
                     pushCursor();
+                    // cheio: apaga o mais antigo da tela e do indice
+                    if (nRects == MAX_RECTS){
+                        slot = oldestRect;
+                        oldestRect = (oldestRect + 1) % MAX_RECTS;
+                        if (rects[slot] != HIT_NONE){
+                            rect = hitGrid->entries[rects[slot]].r;
+                            drawRec(' ', rect.x + 1, rect.y + 1, rect.x + rect.width, rect.y + rect.height);
+                        }
+                        hit_remove(hitGrid, rects[slot]);
+                    }else{
+                        slot = nRects++;
+                    }
                     moveCursor(event.x, event.y);
                     drawRec('.', event.x, event.y, event.x + 10, event.y + 5);
                     popCursor();
+                    rect.x = event.x - 1;
+                    rect.y = event.y - 1;
+                    rect.width = 11;
+                    rect.height = 6;
+                    rects[slot] = hit_add(hitGrid, rect, NULL, 0, NULL);
                 }
                 break;
             default:
@@ -449,6 +684,7 @@ int main(){
         }
     }
     resetTerminal();
+    destroy_hit_grid(hitGrid);
 
     return 0;
 }
@@ -27,6 +27,9 @@
 #define STDOUTF STDOUT_FILENO
 #define TIME_IN_TENTHS_OFSECONDS 0
 #define MAX_EVENT 100
+#define TRACE_FILE "trace.bin"
+// periodo do contador do loop de exemplo
+#define LOOP_MS 100
 #define MOD_INC(var, mod) ((var + 1) % (mod))
 // 0000 0000 0001 1111 = 0x1f
 #define CTRL_KEY(c) ((c) & 0x1f)
@@ -56,6 +59,8 @@ enum EventKey {
 #define B2          (0x1)
 #define B3          (0x2)
 #define B4          (0x3)
+// bits do botao em um movimento sem botao apertado (MOUSE_ALL)
+#define B_NONE      (0x3)
 #define SCROLL_UP   (0x4)
 #define SCROLL_DOWN (0x5)
 
@@ -118,6 +123,14 @@ void setSigIntHandler(void (*handler)(int));
 // 1 caso contrario
 int getTerminalSize(int *rows, int *cols);
 
+// Troca a fonte de input do getEvent, NULL volta para o stdin
+// source deve seguir o contrato do read em modo raw: 0 quando nao tem dados
+void setInputSource(ssize_t (*source)(void *buf, size_t sz));
+
+// Espera ate timeout_ms (-1 = sem limite) por input no stdin
+// retorna 1 se tem input
+int waitInput(int timeout_ms);
+
 // pega um caracter do stdin
 int getEvent(struct Event *e);
 #endif
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "record.h"
+
+#define CHUNK_MAX 4096
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Gravacao //
+static FILE *recFile = NULL;
+static uint64_t recStart;
+static uint64_t chunkTs;
+static unsigned char chunkBuf[CHUNK_MAX];
+static uint32_t chunkLen = 0;
+
+int record_open(const char *path){
+    struct CaptureHeader hdr;
+    if ((recFile = fopen(path, "wb")) == NULL)
+        return -1;
+    memcpy(hdr.magic, CAPTURE_MAGIC, 4);
+    hdr.version = CAPTURE_VERSION;
+    if (fwrite(&hdr, sizeof(hdr), 1, recFile) != 1){
+        fclose(recFile);
+        recFile = NULL;
+        return -1;
+    }
+    recStart = now_ns();
+    chunkLen = 0;
+    return 0;
+}
+
+void record_boundary(void){
+    struct ChunkHeader ch;
+    if (recFile == NULL || chunkLen == 0)
+        return;
+    // o padding depois do len tambem vai para o arquivo
+    memset(&ch, 0, sizeof(ch));
+    ch.ts = chunkTs;
+    ch.len = chunkLen;
+    fwrite(&ch, sizeof(ch), 1, recFile);
+    fwrite(chunkBuf, 1, chunkLen, recFile);
+    chunkLen = 0;
+}
+
+void record_bytes(const void *buf, size_t sz){
+    const unsigned char *p = buf;
+    if (recFile == NULL)
+        return;
+    for (size_t i = 0; i < sz; i++){
+        // chunk cheio, quebra sem fronteira real
+        if (chunkLen == CHUNK_MAX)
+            record_boundary();
+        if (chunkLen == 0)
+            chunkTs = now_ns() - recStart;
+        chunkBuf[chunkLen++] = p[i];
+    }
+}
+
+void record_close(void){
+    if (recFile == NULL)
+        return;
+    record_boundary();
+    fclose(recFile);
+    recFile = NULL;
+}
+// Gravacao //
+
+// Reproducao //
+int capture_load(const char *path, struct Capture *cap){
+    FILE *fp;
+    long sz;
+    size_t off, cap_chunks = 64;
+    struct ChunkHeader ch;
+    struct Chunk *tmp;
+
+    memset(cap, 0, sizeof(*cap));
+    if ((fp = fopen(path, "rb")) == NULL)
+        return -1;
+    if (fseek(fp, 0, SEEK_END) == -1 || (sz = ftell(fp)) < (long)sizeof(struct CaptureHeader)){
+        fclose(fp);
+        return -1;
+    }
+    rewind(fp);
+    if ((cap->raw = malloc(sz)) == NULL || fread(cap->raw, 1, sz, fp) != (size_t)sz){
+        fclose(fp);
+        capture_free(cap);
+        return -1;
+    }
+    fclose(fp);
+
+    if (memcmp(cap->raw, CAPTURE_MAGIC, 4) != 0 ||
+        ((struct CaptureHeader *)cap->raw)->version != CAPTURE_VERSION)
+    {
+        capture_free(cap);
+        return -1;
+    }
+
+    if ((cap->chunks = malloc(sizeof(struct Chunk) * cap_chunks)) == NULL){
+        capture_free(cap);
+        return -1;
+    }
+    off = sizeof(struct CaptureHeader);
+    while (off + sizeof(ch) <= (size_t)sz){
+        memcpy(&ch, cap->raw + off, sizeof(ch));
+        off += sizeof(ch);
+        // chunk truncado, ignora o resto
+        if (off + ch.len > (size_t)sz)
+            break;
+        if (cap->nchunks == cap_chunks){
+            cap_chunks *= 2;
+            if ((tmp = realloc(cap->chunks, sizeof(struct Chunk) * cap_chunks)) == NULL){
+                capture_free(cap);
+                return -1;
+            }
+            cap->chunks = tmp;
+        }
+        cap->chunks[cap->nchunks].ts = ch.ts;
+        cap->chunks[cap->nchunks].len = ch.len;
+        cap->chunks[cap->nchunks].data = cap->raw + off;
+        cap->nchunks++;
+        cap->bytes += ch.len;
+        off += ch.len;
+    }
+
+    return 0;
+}
+
+void capture_free(struct Capture *cap){
+    free(cap->chunks);
+    free(cap->raw);
+    memset(cap, 0, sizeof(*cap));
+}
+
+static struct Capture *replayCap = NULL;
+static size_t replayChunk;
+static uint32_t replayOff;
+static int replayMode;
+static uint64_t replayStart;
+
+void replay_start(struct Capture *cap, int mode){
+    replayCap = cap;
+    replayChunk = 0;
+    replayOff = 0;
+    replayMode = mode;
+    replayStart = now_ns();
+}
+
+ssize_t replay_read(void *buf, size_t sz){
+    struct Chunk *c;
+    struct timespec ts;
+    uint64_t now;
+    size_t n;
+
+    if (replay_done())
+        return 0;
+    c = &replayCap->chunks[replayChunk];
+
+    // fim do chunk: devolve 0 uma vez, igual ao read sem dados
+    if (replayOff == c->len){
+        replayChunk++;
+        replayOff = 0;
+        return 0;
+    }
+
+    if (replayOff == 0 && replayMode == REPLAY_REALTIME){
+        now = now_ns() - replayStart;
+        if (c->ts > now){
+            ts.tv_sec = (c->ts - now) / 1000000000ull;
+            ts.tv_nsec = (c->ts - now) % 1000000000ull;
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    n = c->len - replayOff;
+    if (n > sz)
+        n = sz;
+    memcpy(buf, c->data + replayOff, n);
+    replayOff += n;
+    return n;
+}
+
+int replay_done(void){
+    return replayCap == NULL || replayChunk >= replayCap->nchunks;
+}
+// Reproducao //
@@ -0,0 +1,67 @@
+#ifndef RECORD_H_
+#define RECORD_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Gravacao e reproducao do stdin cru.
+// Formato do arquivo (.cap):
+// struct CaptureHeader
+// repetido ate o fim: struct ChunkHeader + len bytes
+// Cada chunk eh uma sequencia de bytes lidos sem que o read retornasse 0
+// no meio, ou seja, o chunk termina onde o parser viu o fim do input.
+#define CAPTURE_MAGIC   "TCAP"
+#define CAPTURE_VERSION 1
+
+struct CaptureHeader {
+    char magic[4];
+    uint32_t version;
+};
+
+struct ChunkHeader {
+    uint64_t ts;    // ns desde o inicio da gravacao
+    uint32_t len;
+};
+
+struct Chunk {
+    uint64_t ts;
+    uint32_t len;
+    unsigned char *data;
+};
+
+struct Capture {
+    struct Chunk *chunks;
+    size_t nchunks;
+    size_t bytes;
+    unsigned char *raw;     // arquivo inteiro em memoria
+};
+
+// Gravacao
+// retorna -1 em caso de erro
+int record_open(const char *path);
+
+// Adiciona bytes ao chunk atual
+void record_bytes(const void *buf, size_t sz);
+
+// Fecha o chunk atual (read retornou 0)
+void record_boundary(void);
+
+void record_close(void);
+
+// Reproducao
+// retorna -1 em caso de erro
+int capture_load(const char *path, struct Capture *cap);
+
+void capture_free(struct Capture *cap);
+
+#define REPLAY_FAST     0
+#define REPLAY_REALTIME 1
+void replay_start(struct Capture *cap, int mode);
+
+// Mesmo contrato do read em modo raw (VMIN=0): retorna 0 no fim de cada chunk,
+// simulando a fronteira de leitura gravada
+ssize_t replay_read(void *buf, size_t sz);
+
+// retorna 1 quando todos os chunks foram consumidos
+int replay_done(void);
+#endif
@@ -0,0 +1,458 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "trace.h"
+#include "view.h"
+#include "server.h"
+
+#define MAX_EPOLL_EVENTS 64
+#define READ_SZ 512
+
+#define CLIENT_SETUP    "\x1b[?1049h\x1b[?25l\x1b[2J"
+#define CLIENT_RESTORE  "\x1b[?25h\x1b[?1049l"
+// Pede o tamanho do terminal, a resposta eh ESC[8;altura;larguraT
+#define ASK_SIZE        "\x1b[18t"
+
+struct ClientExt {
+    struct Client c;
+    struct termios saved;
+    int has_saved;      // saved foi lido e o tty esta em modo raw
+    int want_out;       // EPOLLOUT registrado
+    int awaiting_size;  // mandou ASK_SIZE e ainda nao recebeu resposta
+    int composed;       // root tem o frame atual (server_present)
+    int closed;         // CLIENT_OPEN, CLIENT_GONE ou CLIENT_DROPPED
+};
+
+#define CLIENT_OPEN    0
+#define CLIENT_GONE    1    // conexao caiu
+#define CLIENT_DROPPED 2    // servidor desconectou
+
+static int set_nonblock(int fd){
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1)
+        return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static int set_events(struct Server *srv, struct ClientExt *ce, int want_out){
+    struct epoll_event ev;
+    if (ce->want_out == want_out)
+        return 0;
+    ev.events = EPOLLIN | (want_out ? EPOLLOUT : 0);
+    ev.data.ptr = ce;
+    ce->want_out = want_out;
+    return epoll_ctl(srv->epfd, EPOLL_CTL_MOD, ce->c.fd, &ev);
+}
+
+// Cria o front com o tamanho do cliente, igual a tela limpa. O root so
+// eh criado no server_present, se nenhum cliente do mesmo tamanho tiver
+static int client_resize(struct Client *c, int width, int height){
+    struct BaseView *front;
+    if (width <= 0 || height <= 0)
+        return -1;
+    if ((front = create_view(width, height, 0, 0)) == NULL)
+        return -1;
+    if (c->root != NULL)
+        destroy_view(c->root);
+    if (c->front != NULL)
+        destroy_view(c->front);
+    c->root = NULL;
+    c->front = front;
+    c->width = width;
+    c->height = height;
+    return 0;
+}
+
+// Escreve o maximo possivel da saida pendente sem bloquear
+static void flush_client(struct Server *srv, struct ClientExt *ce){
+    struct Client *c = &ce->c;
+    ssize_t w;
+
+    while (c->out_off < c->out.len){
+        w = write(c->fd, c->out.data + c->out_off, c->out.len - c->out_off);
+        TRACE_COUNT(TRACE_SYSCALLS, 1);
+        if (w == -1){
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                ce->closed = CLIENT_GONE;
+            break;
+        }
+        c->out_off += w;
+        TRACE(TRACE_BYTES_WRITTEN, w);
+    }
+    if (c->out_off == c->out.len){
+        c->out.len = 0;
+        c->out_off = 0;
+    }
+    if (!ce->closed)
+        set_events(srv, ce, c->out.len > 0);
+}
+
+static void push_event(struct Client *c, const char *seq, int len){
+    int next = (c->ev_head + 1) % CLIENT_MAX_EVENTS;
+    // fila cheia, descarta o evento mais antigo
+    if (next == c->ev_tail)
+        c->ev_tail = (c->ev_tail + 1) % CLIENT_MAX_EVENTS;
+    memcpy(c->events[c->ev_head].seq, seq, len);
+    c->events[c->ev_head].len = len;
+    c->ev_head = next;
+}
+
+// Fecha a sequencia atual; a resposta do ASK_SIZE muda o tamanho do
+// cliente e nao vira evento
+static void end_seq(struct ClientExt *ce){
+    struct Client *c = &ce->c;
+    static const char prefix[] = "\x1b[8;";
+    char report[CLIENT_SEQ_SZ + 1];
+    int h, w;
+
+    if (ce->awaiting_size && c->seq[c->seq_len - 1] == 't' &&
+        c->seq_len > (int)sizeof(prefix) - 1 &&
+        memcmp(c->seq, prefix, sizeof(prefix) - 1) == 0)
+    {
+        memcpy(report, c->seq, c->seq_len);
+        report[c->seq_len] = '\0';
+        if (sscanf(report + sizeof(prefix) - 1, "%d;%dt", &h, &w) == 2 &&
+            client_resize(c, w, h) == 0)
+        {
+            client_invalidate(c);
+            ce->awaiting_size = 0;
+            c->seq_len = 0;
+            return;
+        }
+    }
+    push_event(c, c->seq, c->seq_len);
+    c->seq_len = 0;
+}
+
+// Junta os bytes do cliente em teclas, cada cliente com o seu estado
+static void feed_input(struct ClientExt *ce, unsigned char b){
+    struct Client *c = &ce->c;
+
+    c->fresh = 1;
+    // ESC no meio de uma sequencia: a anterior estava quebrada
+    if (c->seq_len > 0 && b == 0x1b)
+        end_seq(ce);
+    if (c->seq_len == 0){
+        if (b == 0x1b)
+            c->seq[c->seq_len++] = b;
+        else
+            push_event(c, (char *)&b, 1);
+        return;
+    }
+
+    c->seq[c->seq_len++] = b;
+    if (c->seq_len == 2){
+        // ESC x (alt + x) termina aqui, ESC [ e ESC O continuam
+        if (b != '[' && b != 'O')
+            end_seq(ce);
+    }else if (c->seq[1] == 'O' || (b >= 0x40 && b <= 0x7e) ||
+              c->seq_len == CLIENT_SEQ_SZ)
+    {
+        // ESC O x, byte final do CSI ou sequencia grande demais
+        end_seq(ce);
+    }
+}
+
+static void read_client(struct ClientExt *ce){
+    unsigned char buf[READ_SZ];
+    ssize_t n;
+
+    for (;;){
+        n = read(ce->c.fd, buf, sizeof(buf));
+        TRACE_COUNT(TRACE_SYSCALLS, 1);
+        if (n == 0){
+            ce->closed = CLIENT_GONE;
+            return;
+        }
+        if (n == -1){
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                ce->closed = CLIENT_GONE;
+            return;
+        }
+        TRACE_COUNT(TRACE_INPUT_BYTES, n);
+        for (ssize_t i = 0; i < n; i++)
+            feed_input(ce, buf[i]);
+    }
+}
+
+// Desfaz o que o server_add_fd ja tinha feito, o fd continua aberto
+static struct Client *add_failed(struct ClientExt *ce){
+    if (ce->has_saved)
+        tcsetattr(ce->c.fd, TCSAFLUSH, &ce->saved);
+    if (ce->c.root != NULL)
+        destroy_view(ce->c.root);
+    if (ce->c.front != NULL)
+        destroy_view(ce->c.front);
+    outbuf_free(&ce->c.out);
+    free(ce);
+    return NULL;
+}
+
+struct Client *server_add_fd(struct Server *srv, int fd){
+    struct ClientExt *ce;
+    struct epoll_event ev;
+    struct winsize ws;
+    struct termios raw;
+    int width = CLIENT_DEF_WIDTH, height = CLIENT_DEF_HEIGHT;
+
+    if (srv == NULL || fd < 0 || srv->nclients == SERVER_MAX_CLIENTS)
+        return NULL;
+    if ((ce = calloc(1, sizeof(struct ClientExt))) == NULL)
+        return NULL;
+    ce->c.fd = fd;
+
+    if (isatty(fd)){
+        ce->c.is_tty = 1;
+        if (ioctl(fd, TIOCGWINSZ, &ws) != -1 && ws.ws_col > 0){
+            width = ws.ws_col;
+            height = ws.ws_row;
+        }
+        if (tcgetattr(fd, &ce->saved) == 0){
+            raw = ce->saved;
+            cfmakeraw(&raw);
+            if (tcsetattr(fd, TCSAFLUSH, &raw) == 0)
+                ce->has_saved = 1;
+        }
+    }else{
+        ce->awaiting_size = 1;
+    }
+
+    if (set_nonblock(fd) == -1 || client_resize(&ce->c, width, height) == -1)
+        return add_failed(ce);
+    // sem o setup inteiro o cliente ficaria esperando a resposta do tamanho
+    if (outbuf_append(&ce->c.out, CLIENT_SETUP, sizeof(CLIENT_SETUP) - 1) == -1 ||
+        (ce->awaiting_size &&
+         outbuf_append(&ce->c.out, ASK_SIZE, sizeof(ASK_SIZE) - 1) == -1))
+        return add_failed(ce);
+    ev.events = EPOLLIN;
+    ev.data.ptr = ce;
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+        return add_failed(ce);
+
+    srv->clients[srv->nclients++] = &ce->c;
+    flush_client(srv, ce);
+
+    return &ce->c;
+}
+
+static void free_client(struct Server *srv, struct ClientExt *ce){
+    epoll_ctl(srv->epfd, EPOLL_CTL_DEL, ce->c.fd, NULL);
+    if (ce->has_saved)
+        tcsetattr(ce->c.fd, TCSAFLUSH, &ce->saved);
+    close(ce->c.fd);
+    if (ce->c.root != NULL)
+        destroy_view(ce->c.root);
+    destroy_view(ce->c.front);
+    outbuf_free(&ce->c.out);
+    free(ce);
+}
+
+void server_drop_client(struct Server *srv, struct Client *c){
+    if (srv == NULL || c == NULL)
+        return;
+    // libera em sweep_clients, pode ter eventos do mesmo epoll_wait apontando pra ele
+    ((struct ClientExt *)c)->closed = CLIENT_DROPPED;
+}
+
+static void sweep_clients(struct Server *srv){
+    struct ClientExt *ce;
+    for (int i = 0; i < srv->nclients; i++){
+        ce = (struct ClientExt *)srv->clients[i];
+        if (ce->closed == CLIENT_OPEN)
+            continue;
+        if (ce->closed == CLIENT_DROPPED)
+            write(ce->c.fd, CLIENT_RESTORE, sizeof(CLIENT_RESTORE) - 1);
+        free_client(srv, ce);
+        srv->clients[i--] = srv->clients[--srv->nclients];
+    }
+}
+
+struct Server *server_open(const char *path){
+    struct Server *srv;
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+
+    if ((srv = calloc(1, sizeof(struct Server))) == NULL)
+        return NULL;
+    srv->listen_fd = -1;
+    // escrever em um cliente que fechou nao pode matar o servidor
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((srv->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1){
+        free(srv);
+        return NULL;
+    }
+    if (path == NULL)
+        return srv;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return server_close(srv);
+    strcpy(addr.sun_path, path);
+    strcpy(srv->path, path);
+    unlink(path);
+
+    if ((srv->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+        bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        listen(srv->listen_fd, SERVER_MAX_CLIENTS) == -1)
+        return server_close(srv);
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->listen_fd, &ev) == -1)
+        return server_close(srv);
+
+    return srv;
+}
+
+struct Server *server_close(struct Server *srv){
+    struct ClientExt *ce;
+    if (srv == NULL)
+        return NULL;
+    for (int i = 0; i < srv->nclients; i++){
+        ce = (struct ClientExt *)srv->clients[i];
+        // ultima tentativa de devolver o terminal do cliente ao normal
+        if (ce->closed != CLIENT_GONE)
+            write(ce->c.fd, CLIENT_RESTORE, sizeof(CLIENT_RESTORE) - 1);
+        free_client(srv, ce);
+    }
+    if (srv->listen_fd != -1){
+        close(srv->listen_fd);
+        unlink(srv->path);
+    }
+    close(srv->epfd);
+    free(srv);
+
+    return NULL;
+}
+
+static void accept_clients(struct Server *srv){
+    int fd;
+    while ((fd = accept4(srv->listen_fd, NULL, NULL, SOCK_CLOEXEC)) != -1){
+        if (server_add_fd(srv, fd) == NULL)
+            close(fd);
+    }
+}
+
+int server_poll(struct Server *srv, int timeout_ms){
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    struct ClientExt *ce;
+    int n;
+
+    if (srv == NULL)
+        return -1;
+    n = epoll_wait(srv->epfd, events, MAX_EPOLL_EVENTS, timeout_ms);
+    TRACE_COUNT(TRACE_SYSCALLS, 1);
+    if (n == -1)
+        return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < n; i++){
+        ce = events[i].data.ptr;
+        if (ce == NULL){
+            accept_clients(srv);
+            continue;
+        }
+        if (ce->closed)
+            continue;
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            read_client(ce);
+        if (!ce->closed && (events[i].events & EPOLLOUT))
+            flush_client(srv, ce);
+    }
+    // ESC sozinho: se nada mais chegou desde o ultimo poll eh a tecla ESC
+    for (int i = 0; i < srv->nclients; i++){
+        if (!srv->clients[i]->fresh && srv->clients[i]->seq_len > 0)
+            end_seq((struct ClientExt *)srv->clients[i]);
+        srv->clients[i]->fresh = 0;
+    }
+    sweep_clients(srv);
+
+    return n;
+}
+
+// root ja composto neste frame para um cliente de width x height
+static struct BaseView *composed_root(struct Server *srv, int width, int height){
+    struct ClientExt *ce;
+    for (int i = 0; i < srv->nclients; i++){
+        ce = (struct ClientExt *)srv->clients[i];
+        if (ce->composed && ce->c.width == width && ce->c.height == height)
+            return ce->c.root;
+    }
+    return NULL;
+}
+
+int server_present(struct Server *srv, ComposeFn compose, void *ctx){
+    struct ClientExt *ce;
+    struct BaseView *root;
+    int sent = 0;
+
+    if (srv == NULL || compose == NULL)
+        return 0;
+    for (int i = 0; i < srv->nclients; i++)
+        ((struct ClientExt *)srv->clients[i])->composed = 0;
+    for (int i = 0; i < srv->nclients; i++){
+        ce = (struct ClientExt *)srv->clients[i];
+        // cliente lento: pula o frame, o front continua igual ao que
+        // o terminal vai mostrar quando a saida pendente acabar
+        if (ce->closed)
+            continue;
+        if (ce->c.out.len - ce->c.out_off > CLIENT_MAX_PENDING){
+            TRACE(TRACE_FRAMES_DROPPED, 1);
+            continue;
+        }
+        // so compoe de novo para um tamanho que ainda nao apareceu, e so
+        // o primeiro cliente de cada tamanho tem um root proprio
+        if ((root = composed_root(srv, ce->c.width, ce->c.height)) != NULL){
+            if (ce->c.root != NULL)
+                ce->c.root = destroy_view(ce->c.root);
+        }else{
+            if (ce->c.root == NULL &&
+                (ce->c.root = create_view(ce->c.width, ce->c.height, 0, 0)) == NULL){
+                ce->closed = CLIENT_DROPPED;
+                continue;
+            }
+            root = ce->c.root;
+            compose(root, ctx);
+            ce->composed = 1;
+        }
+        // sem memoria o diff fica pela metade e o front nao bate com a tela
+        if (diff_view(ce->c.front, root, &ce->c.out) == -1){
+            ce->closed = CLIENT_DROPPED;
+            continue;
+        }
+        flush_client(srv, ce);
+        sent++;
+    }
+    sweep_clients(srv);
+
+    return sent;
+}
+
+void client_invalidate(struct Client *c){
+    // TRANSPARENT_PIXEL nunca eh enviado, entao todo cell fica diferente
+    if (c != NULL && c->front != NULL)
+        fill_view(c->front, TRANSPARENT_PIXEL);
+}
+
+int client_next_event(struct Client *c, struct ClientEvent *ev){
+    if (c == NULL || ev == NULL || c->ev_tail == c->ev_head)
+        return 0;
+    *ev = c->events[c->ev_tail];
+    c->ev_tail = (c->ev_tail + 1) % CLIENT_MAX_EVENTS;
+    return 1;
+}
@@ -0,0 +1,88 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+#include "view.h"
+
+// Modo servidor: um processo atende varios terminais (socket unix ou
+// fds de pty) a partir de um unico epoll. A tela eh composta uma vez por
+// tamanho de terminal: clientes com o mesmo tamanho dividem o mesmo frame.
+// Cada cliente tem seu proprio root e front no tamanho dele, estado de
+// diff, parser de input e fila de eventos, entao o custo por cliente eh
+// so o diff e o write, e sequencias de escape de clientes diferentes
+// nunca se misturam.
+
+#define SERVER_MAX_CLIENTS 64
+#define CLIENT_MAX_EVENTS  64
+#define CLIENT_SEQ_SZ      32
+// Acima disso o cliente esta atrasado e nao recebe frames novos
+// ate esvaziar a saida pendente
+#define CLIENT_MAX_PENDING (64 * 1024)
+#define CLIENT_DEF_WIDTH   80
+#define CLIENT_DEF_HEIGHT  24
+
+// Uma tecla: um byte ou uma sequencia de escape inteira (ESC x, ESC O x,
+// ESC [ ... final)
+struct ClientEvent {
+    char seq[CLIENT_SEQ_SZ];
+    int len;
+};
+
+struct Client {
+    int fd;
+    int width, height;
+    int is_tty;             // fd de pty/tty, tamanho vem do TIOCGWINSZ
+    // frame composto no tamanho do cliente, NULL quando o frame vem do
+    // root de outro cliente do mesmo tamanho
+    struct BaseView *root;
+    struct BaseView *front; // o que o terminal do cliente esta mostrando
+    struct OutBuf out;      // saida pendente
+    size_t out_off;         // quanto de out ja foi escrito
+    // sequencia de escape sendo lida
+    char seq[CLIENT_SEQ_SZ];
+    int seq_len;
+    int fresh;              // chegou input neste server_poll
+    // fila de eventos do cliente
+    struct ClientEvent events[CLIENT_MAX_EVENTS];
+    int ev_head, ev_tail;
+};
+
+// Desenha o frame em root, que tem o tamanho de um ou mais clientes
+typedef void (*ComposeFn)(struct BaseView *root, void *ctx);
+
+struct Server {
+    int listen_fd;
+    int epfd;
+    char path[108];
+    struct Client *clients[SERVER_MAX_CLIENTS];
+    int nclients;
+};
+
+// Cria o socket unix em path, NULL cria um servidor sem socket
+// (clientes entram por server_add_fd)
+// retorna NULL em caso de erro
+struct Server *server_open(const char *path);
+
+struct Server *server_close(struct Server *srv);
+
+// Adiciona um terminal ja aberto (ex: master de um pty)
+// retorna o cliente, NULL em caso de erro
+struct Client *server_add_fd(struct Server *srv, int fd);
+
+// Espera ate timeout_ms por atividade: aceita conexoes, le input
+// e escreve a saida pendente
+// retorna o numero de eventos tratados, -1 em caso de erro
+int server_poll(struct Server *srv, int timeout_ms);
+
+// Chama compose uma vez para cada tamanho de cliente, faz o diff do
+// frame contra o front de cada cliente desse tamanho e enfileira a saida
+// retorna quantos clientes receberam o frame
+int server_present(struct Server *srv, ComposeFn compose, void *ctx);
+
+// Redesenha a tela inteira do cliente no proximo present
+void client_invalidate(struct Client *c);
+
+// Tira o proximo evento da fila do cliente
+// retorna 0 se a fila estiver vazia
+int client_next_event(struct Client *c, struct ClientEvent *ev);
+
+void server_drop_client(struct Server *srv, struct Client *c);
+#endif
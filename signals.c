@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include "trace.h"
+#include "signals.h"
+
+static sigset_t oldMask;
+
+int signals_open(void){
+    sigset_t mask;
+    int fd;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTSTP);
+    sigaddset(&mask, SIGCONT);
+    sigaddset(&mask, SIGWINCH);
+    if (sigprocmask(SIG_BLOCK, &mask, &oldMask) == -1)
+        return -1;
+    if ((fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1){
+        sigprocmask(SIG_SETMASK, &oldMask, NULL);
+        return -1;
+    }
+
+    return fd;
+}
+
+void signals_close(int fd){
+    if (fd == -1)
+        return;
+    close(fd);
+    sigprocmask(SIG_SETMASK, &oldMask, NULL);
+}
+
+int signals_read(int fd){
+    struct signalfd_siginfo info[8];
+    ssize_t n;
+    int got = 0;
+
+    if (fd == -1)
+        return 0;
+    for (;;){
+        n = read(fd, info, sizeof(info));
+        TRACE_COUNT(TRACE_SYSCALLS, 1);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        for (size_t i = 0; i < n / sizeof(info[0]); i++){
+            switch (info[i].ssi_signo){
+                case SIGINT:  got |= SIGNAL_INT;  break;
+                case SIGTSTP: got |= SIGNAL_TSTP; break;
+                case SIGCONT: got |= SIGNAL_CONT; break;
+                case SIGWINCH: got |= SIGNAL_WINCH; break;
+            }
+        }
+    }
+
+    return got;
+}
+
+int signals_stop(int fd){
+    struct sigaction dfl, old;
+    sigset_t tstp;
+
+    memset(&dfl, 0, sizeof(dfl));
+    dfl.sa_handler = SIG_DFL;
+    sigemptyset(&dfl.sa_mask);
+    sigaction(SIGTSTP, &dfl, &old);
+    sigemptyset(&tstp);
+    sigaddset(&tstp, SIGTSTP);
+
+    // o SIGTSTP original ja foi lido do fd: manda outro enquanto esta
+    // bloqueado e desbloqueia, a acao padrao para o processo aqui
+    raise(SIGTSTP);
+    sigprocmask(SIG_UNBLOCK, &tstp, NULL);
+    // voltou pelo SIGCONT
+    sigprocmask(SIG_BLOCK, &tstp, NULL);
+    sigaction(SIGTSTP, &old, NULL);
+
+    // o SIGCONT que acordou o processo ja esta pendente no fd
+    return signals_read(fd) & ~SIGNAL_CONT;
+}
@@ -0,0 +1,32 @@
+#ifndef SIGNALS_H_
+#define SIGNALS_H_
+
+// Sinais de controle do terminal entregues por um signalfd, para serem
+// tratados no loop de eventos e nao dentro de um handler (onde quase nada
+// eh async-signal-safe). Os sinais ficam bloqueados enquanto o fd estiver
+// aberto.
+
+#define SIGNAL_INT   (1 << 0)   // SIGINT
+#define SIGNAL_TSTP  (1 << 1)   // SIGTSTP (ctrl-z)
+#define SIGNAL_CONT  (1 << 2)   // SIGCONT
+#define SIGNAL_WINCH (1 << 3)   // SIGWINCH
+
+// Bloqueia SIGINT, SIGTSTP, SIGCONT e SIGWINCH e cria o signalfd
+// (nao bloqueante) que recebe eles
+// retorna o fd, -1 em caso de erro
+int signals_open(void);
+
+// Fecha o fd e desbloqueia os sinais
+void signals_close(int fd);
+
+// Le todos os sinais pendentes. Sinais padrao nao enfileiram, varios
+// SIGWINCH antes da leitura ja chegam como um so
+// retorna a mascara SIGNAL_* dos sinais lidos, 0 se nao tinha nenhum
+int signals_read(int fd);
+
+// Manda o SIGTSTP de novo com a acao padrao, assim o shell ve o processo
+// parar pelo SIGTSTP, e volta quando receber o SIGCONT.
+// O terminal deve ser restaurado antes
+// retorna os sinais que chegaram enquanto estava parado, sem o SIGCONT
+int signals_stop(int fd);
+#endif
@@ -5,180 +5,34 @@
 #include <stdarg.h>
 #include <signal.h>
 #include <unistd.h>
+#include <termios.h>
 #include "term_control.h"
+#include "trace.h"
+#include "view.h"
+#include "list_view.h"
+#include "fb_export.h"
+#include "server.h"
+#include "output.h"
+#include "signals.h"
+#include "text_search.h"
+#include "layout.h"
+#include "braille.h"
 
 #define DEBUG_TTY "log.txt"
+#define TRACE_FILE "trace.bin"
 #define DEBUG(fd, fmt, ...) fprintf(fd, fmt, __VA_ARGS__)
 #define ARR_SZ(xs) (sizeof(xs)/sizeof(xs[0]))
 #define MAX_CHILD 4
-#define TRANSPARENT_PIXEL '\0'
-
-#define printf_to_view(vw, x, y, sz, fmt, ...)      \
-    do{                                             \
-        __b__ = malloc(sizeof(char) * (sz));  \
-        if (__b__ == NULL)                          \
-            break;                                  \
-        snprintf(__b__, (sz), fmt, __VA_ARGS__);    \
-        print_to_view((vw), (x), (y), (sz), __b__); \
-        free(__b__);                                \
-    }while(0);                                      
-#define POSTYPE struct {int x, y, width, height;}
 
 FILE *f;
 
-struct BaseView {
-    POSTYPE;
-    char *buffer;
-}BaseView;
-
-struct TextView {
-    POSTYPE;
-    char *text;
-    enum {
-        CENTER,
-        LEFT
-    } alignment;
-    enum {
-        YES,
-        NO
-    } wraping;
-    char bg;
-    int length;
-}TextView;
-
-// Utils //
-void clamp_int(int *x, int min, int max){
-    if (*x > max) *x = max;
-    if (*x < min) *x = min;
-}
-
-int in_range(int x, int a, int b){
-    return (x >= a && x <= b);
-}
-
-int is_printable_char(char c){
-    return (' ' <= c && c <= '~');
-}
-// Utils //
-
-// View //
-void fill_view(struct BaseView *vw, char c){
-    for (int i = 0; i < vw->height; i++){
-        for (int j = 0; j < vw->width; j++)
-            vw->buffer[i * vw->width + j] = c;
-    }
-}
-
-struct BaseView *create_view(int width, int height, int x, int y){
-    struct BaseView *vw = malloc(sizeof(BaseView));
-
-    if (vw == NULL)
-        return NULL;
+// Escritas de uma vez so ao suspender e ao voltar
+#define TERM_RESTORE "\x1b[?25h\x1b[?1049l"
+#define TERM_SETUP   "\x1b[?1049h\x1b[?25l"
 
-    if ((vw->buffer = malloc(sizeof(char) * width * height)) == NULL){
-        free(vw);
-        return NULL;
-    }
-
-    vw->width = width;
-    vw->height = height;
-    vw->x = x;
-    vw->y = y;
-    fill_view(vw, ' ');
-
-    return vw;
-}
-
-struct BaseView *destroy_view(struct BaseView *vw){
-    free(vw->buffer);
-    free(vw);
+// modos do tty antes e depois do set_terminal
+struct termios saved_term, app_term;
 
-    return NULL;
-}
-
-// return 1 se conseguir setar o valor
-int set_value(struct BaseView *vw, int x, int y, char value){
-    if (vw == NULL ||
-       !in_range(x, 0, vw->width-1) || !in_range(y, 0, vw->height-1)
-    )
-        return 0;
-    vw->buffer[y * vw->width + x] = value;
-    return 1;
-}
-
-// Joga o buffer de vw em vw2->buffer
-// retorna -1 se tiver erro
-int render_vw_to_view(struct BaseView *vw, struct BaseView *vw2){
-    int x = 0;
-    int y = 0;
-    int rendered = 0;
-    char value;
-    if (vw == NULL || vw2 == NULL)
-        return -1;
-
-    for (int i = 0; i < vw->height; i++){
-        // y relativo a vw
-        y = vw->y + i;
-        for (int j = 0; j < vw->width; j++){
-            // x relativo a vw
-            x = vw->x + j;
-            // Pega o valor no buffer vw, para jogar em vw2
-            value = vw->buffer[i * vw->width + j];
-            if (value != TRANSPARENT_PIXEL &&
-                in_range(x, 0, vw2->width - 1) &&
-                in_range(y, 0, vw2->height - 1))
-            {
-                vw2->buffer[y * vw2->width + x] = value;
-                rendered++;
-            }
-        }
-    }
-
-    return rendered;
-}
-
-// Imprime um texto no buffer de vw
-// retorna -1 se algo der errado, caso contratio quantos valores foram impressos
-int print_to_view(struct BaseView *vw, int x_off, int y_off,
-                           int txt_sz, char *txt)
-{
-    char v;
-    int x = x_off, y = y_off;
-    int rendered = 0;
-    if (vw == NULL)
-        return -1;
-
-    for (int i = 0; i < txt_sz; i++){
-        v = txt[i];
-        if (v == TRANSPARENT_PIXEL){
-            x++;
-        }else if (v == '\n'){
-            y++;
-            x = x_off;
-        }else if (is_printable_char(v)){
-            if (in_range(x, 0, vw->width - 1) && in_range(y, 0, vw->height - 1)){
-                vw->buffer[y * vw->width + x] = v;
-                x++;
-                rendered++;
-            }
-        }else{
-            fprintf(stderr, "[ERRO]: Carcater com codigo '%d' nao suportado\n", (int)v);
-            return rendered;
-        }
-
-    }
-
-    return rendered;
-}
-
-void render_view(struct BaseView *vw){
-    if (vw == NULL)
-        return;
-
-    for (int y = 0; y < vw->height - 1; y++)
-        printf("%.*s\n", vw->width, &vw->buffer[y * vw->width]);
-}
-// View //
 void set_terminal(void){
     echo_off();
     canon_off();
@@ -198,95 +52,135 @@ void on_sigint(int sig){
     running = 0;
 }
 
-struct TextView *create_text(int width, int height, int x, int y){
-    struct TextView *txt = calloc(1, sizeof(TextView));
+// ctrl-z: devolve o terminal e para. A volta fica com o SIGNAL_CONT do
+// loop, depois do SIGWINCH que tenha chegado enquanto estava parado
+// retorna os sinais que chegaram enquanto estava parado, mais SIGNAL_CONT
+int suspend(struct Output *out, int sig_fd){
+    int got;
+    output_suspend(out, TERM_RESTORE, sizeof(TERM_RESTORE) - 1);
+    tcsetattr(1, TCSANOW, &saved_term);
 
-    if (txt == NULL)
-        return NULL;
+    got = signals_stop(sig_fd);
 
-    txt->width = width;
-    txt->height = height;
-    txt->x = x;
-    txt->y = y;
-    txt->alignment = LEFT;
-    txt->wraping = NO;
-    txt->bg = '.';
-    txt->length = 0;
+    return got | SIGNAL_CONT;
+}
 
-    return txt;
+#define DEMO_ROWS 1000000
+
+// Dataset da lista de exemplo, as linhas so existem quando sao pedidas
+int demo_row(long row, int col, char *buf, int sz, void *ctx){
+    char tmp[32];
+    int n;
+    (void)ctx;
+    if (col == 0)
+        n = snprintf(tmp, sizeof(tmp), "linha %ld", row);
+    else
+        n = snprintf(tmp, sizeof(tmp), "%08lx", (unsigned long)(row * 2654435761u));
+    if (n > sz)
+        n = sz;
+    memcpy(buf, tmp, n);
+    return n;
 }
-// TODO: melhor forma de retornar
-char *load_text(struct TextView *txt, const char *text){
-    if (txt == NULL)
-        return NULL;
-    txt->length = strlen(text);
-    txt->text = strdup(text);
-    if (txt->text == NULL)
-        return NULL;
-    return txt->text;
+
+// apply do layout para a lista
+void place_list(struct LayoutNode *n, void *lst){
+    struct ListView *l = lst;
+    l->x = n->rect.x;
+    l->y = n->rect.y;
+    list_resize(l, n->rect.width, n->rect.height);
 }
 
-struct TextView *destroi_text(struct TextView *txt){
-    if (txt == NULL)
-        return NULL;
-    if (txt->text != NULL)
-        free(txt->text);
-    free(txt);
+// o canvas tem tamanho fixo, um resize do no cria outro
+void place_plot(struct LayoutNode *n, void *plot){
+    struct BrailleCanvas **p = plot;
+    if (*p != NULL && (*p)->width == n->rect.width && (*p)->height == n->rect.height){
+        (*p)->x = n->rect.x;
+        (*p)->y = n->rect.y;
+        return;
+    }
+    destroy_braille(*p);
+    *p = create_braille(n->rect.width, n->rect.height, n->rect.x, n->rect.y);
+}
+
+// colunas de pontos guardadas do grafico de bytes por frame
+#define PLOT_HISTORY 1024
+
+#define SERVER_TICK_MS 100
+#define FRAME_MS 16
+
+struct ServeFrame {
+    struct Server *srv;
+    struct TextView *txt;
+    long frame;
+};
 
-    return NULL;
+// Desenha a tela do servidor em root, no tamanho dos clientes que vao
+// receber esse frame
+void compose_served(struct BaseView *root, void *ctx){
+    struct ServeFrame *sf = ctx;
+    char status[64];
+    int n;
+
+    sf->txt->width = root->width/2;
+    sf->txt->height = root->height/2;
+    fill_view(root, '_');
+    render_text_to_view(sf->txt, root);
+    n = snprintf(status, sizeof(status), " clientes: %d  frame: %ld  %dx%d ",
+                 sf->srv->nclients, sf->frame, root->width, root->height);
+    print_to_view(root, 0, root->height - 1, n, status);
+    if (getenv("TERMAL_STATS") != NULL)
+        render_trace_overlay(root);
 }
 
-// TODO: melhor forma de retornar
-void render_text_to_view(struct TextView *txt, struct BaseView *v){
-    int dx, dy, x, y;
-    dx = dy = 0;
-    if (txt == NULL || v == NULL)
-        return;
-    x = txt->x;
-    y = txt->y;
-    for (int i = 0; i < txt->height; i++)
-        for (int j = 0; j < txt->width; j++)
-            v->buffer[(y + i) * v->width + x + j] = txt->bg;      
-    switch (txt->wraping){
-        case NO:
-            for (int i = 0; i < txt->length; i++){
-                if (txt->text[i] == '\n'){
-                    dx = 0;
-                    dy++;
-                }
-                // TODO: verificar se x + dx e y + dy estao dentro da view
-                else if (in_range(dx, 0, txt->width-1) &&
-                    in_range(dy, 0, txt->height-1))
-                {
-                    v->buffer[(y + dy) * v->width + x + dx] = txt->text[i];      
-                    dx++;
-                }
-            }
-            break;
-        case YES:
-            for (int i = 0; i < txt->length; i++){
-                if (txt->text[i] == '\n'){
-                    dx = 0;
-                    dy++;
-                }
-                // TODO: verificar se x + dx e y + dy estao dentro da view
-                else{
-                    if (!in_range(dx, 0, txt->width-1)){
-                        dx = 0;
-                        dy++;
-                    }
-                    if (in_range(dy, 0, txt->height-1)){
-                        v->buffer[(y + dy) * v->width + x + dx] = txt->text[i];      
-                        dx++;
-                    }
-                }
-            }
-            break;
-        default: break;
+// Compoe a tela uma vez por tick e tamanho de terminal e manda para
+// todos os clientes
+// retorna 0 se terminou sem erro
+int serve(const char *path){
+    struct ClientEvent ev;
+    struct ServeFrame sf;
+    struct Server *srv = server_open(path);
+    struct TextView *txt = create_text(CLIENT_DEF_WIDTH/2, CLIENT_DEF_HEIGHT/2, 10, 5);
+
+    if (srv == NULL || txt == NULL){
+        fprintf(stderr, "[ERRO]: Nao foi possivel iniciar o servidor em %s\n", path);
+        server_close(srv);
+        destroi_text(txt);
+        return 1;
     }
+    load_text(txt, "TERMAL - servidor\n\n'q' desconecta este terminal");
+    txt->wraping = YES;
+    sf.srv = srv;
+    sf.txt = txt;
+    sf.frame = 0;
+
+    while (running){
+        server_present(srv, compose_served, &sf);
+        sf.frame++;
+        TRACE_FRAME();
+        server_poll(srv, SERVER_TICK_MS);
+
+        // cada cliente tem a sua fila de eventos ja separados em teclas
+        for (int i = 0; i < srv->nclients; i++)
+            while (client_next_event(srv->clients[i], &ev))
+                if (ev.len == 1 && ev.seq[0] == 'q')
+                    server_drop_client(srv, srv->clients[i]);
+    }
+
+    server_close(srv);
+    destroi_text(txt);
+    return 0;
+}
+
+static struct Rect rect_at(int x, int y, int width, int height){
+    struct Rect r;
+    r.x = x;
+    r.y = y;
+    r.width = width;
+    r.height = height;
+    return r;
 }
 
-int main(){
+int main(int argc, char **argv){
     int width, height;
     // __b__ usado para o macro printf_to_view
     char c, *__b__;
@@ -296,24 +190,186 @@ int main(){
         exit(1);
     }
 
+    trace_dump_on_exit(TRACE_FILE);
+    if (trace_dump_on_signal(SIGUSR1, TRACE_FILE) == -1)
+        fprintf(stderr, "[ERRO]: Nao foi possivel capturar o sinal SIGUSR1\n");
+
+    // termal -s /tmp/termal.sock
+    if (argc == 3 && strcmp(argv[1], "-s") == 0)
+        return serve(argv[2]);
+
     get_size(&width, &height);
+    tcgetattr(1, &saved_term);
     set_terminal();
+    tcgetattr(1, &app_term);
+    // SIGINT, SIGTSTP, SIGCONT e SIGWINCH chegam pelo loop
+    int sig_fd = signals_open();
+    if (sig_fd == -1)
+        DEBUG(f, "[ERRO]: Nao foi possivel criar o signalfd%s\n", "");
 
     struct BaseView *root = create_view(width, height, 0, 0);
-    fill_view(root, '_');
+    struct FbExport *fb = NULL;
+    // TERMAL_SHM=/nome exporta os frames em /dev/shm/nome
+    if (getenv("TERMAL_SHM") != NULL &&
+        (fb = fb_export_open(getenv("TERMAL_SHM"), width, height)) == NULL)
+        DEBUG(f, "[ERRO]: Nao foi possivel exportar o frame em %s\n", getenv("TERMAL_SHM"));
     struct TextView *txt = create_text(width/4, height/2, 10, 10);
+    // lista virtual ao lado do texto, rola uma linha por frame
+    struct ListView *lst = create_list(width/4, height/2, 0, 10, DEMO_ROWS, demo_row, NULL);
+    int cols[] = {14, 0};
+    list_set_columns(lst, ARR_SZ(cols), cols);
+    // texto a 10 cells do canto, com 1/4 da largura e metade da altura,
+    // e a lista no resto da faixa, 2 cells depois do texto
+    struct BrailleCanvas *plot = NULL;
+    float history[PLOT_HISTORY];
+    uint64_t last[TRACE_N];
+    int nhistory = 0;
+    struct Layout *lay = create_layout(width, height, LAYOUT_COLUMN);
+    if (lay != NULL){
+        layout_add(lay->root, LAYOUT_ROW, SIZE_FIXED, 10);
+        struct LayoutNode *band = layout_add(lay->root, LAYOUT_ROW, SIZE_PERCENT, 50);
+        struct LayoutNode *bottom = layout_add(lay->root, LAYOUT_ROW, SIZE_FLEX, 1);
+        layout_add(band, LAYOUT_COLUMN, SIZE_FIXED, 10);
+        layout_bind(layout_add(band, LAYOUT_COLUMN, SIZE_PERCENT, 25), layout_place_text, txt);
+        layout_add(band, LAYOUT_COLUMN, SIZE_FIXED, 2);
+        if (lst != NULL)
+            layout_bind(layout_add(band, LAYOUT_COLUMN, SIZE_FLEX, 1), place_list, lst);
+        // grafico dos bytes escritos por frame embaixo, 1 cell de borda
+        // para nao cobrir a linha de status
+        layout_set_box(bottom, 0, 1);
+        layout_bind(layout_add(bottom, LAYOUT_ROW, SIZE_FLEX, 1), place_plot, &plot);
+    }
     load_text(txt, "ola meu velho amigo\nComo esta?\n\n\nMeu mano eu estou meuite0 bem vomo pode algo tao lindo assim nao eh? Como vai pedor\n\n\n\n\n\n\n\n\n\n\nele esta bem????????????\n\n\n\n\nalsadaio  asdasdsdad  adsaddasdsadasd asdadasdad a asdadsadada");
 
-    clear_screen(root->height);
+    // o front do Output comeca invalido, o primeiro frame desenha tudo
+    struct Output *out = output_open(STDOUT_FILENO, width, height);
+    if (out == NULL){
+        reset_terminal();
+        fprintf(stderr, "[ERRO]: Nao foi possivel abrir a saida\n");
+        return 1;
+    }
     txt->wraping = YES;
-    render_text_to_view(txt, root);
-    render_view(root);
+    // TERMAL_FIND=padrao destaca os matches no texto
+    struct TextSearch *find = NULL;
+    if (getenv("TERMAL_FIND") != NULL &&
+        (find = text_search_start(txt, getenv("TERMAL_FIND"))) == NULL)
+        DEBUG(f, "[ERRO]: Nao foi possivel buscar %s\n", getenv("TERMAL_FIND"));
+
+    char status[64];
+    long frame = 0;
+    // damage do layout mais texto, lista, grafico, status e as
+    // estatisticas do frame anterior e deste
+    struct Rect dirty[LAYOUT_MAX_DAMAGE + 6], stats = {0};
+    int n, ndirty, redraw = 1, sigs = 0;
+    long found;
+    while (running){
+        // o SIGWINCH de um resize enquanto estava parado volta junto
+        if (sigs & SIGNAL_TSTP)
+            sigs |= suspend(out, sig_fd);
+        if (sigs & SIGNAL_WINCH){
+            get_size(&width, &height);
+            struct BaseView *vw = create_view(width, height, 0, 0);
+            if (vw != NULL && output_resize(out, width, height) != -1){
+                destroy_view(root);
+                root = vw;
+                redraw = 1;
+                layout_resize(lay, width, height);
+            }else if (vw != NULL){
+                destroy_view(vw);
+            }
+        }
+        // SIGCONT: volta o modo do tty e redesenha uma vez; com SIGWINCH o
+        // front ja foi invalidado e o frame abaixo sai inteiro no tamanho novo
+        if (sigs & SIGNAL_CONT){
+            tcsetattr(1, TCSANOW, &app_term);
+            output_repaint(out, TERM_SETUP, sizeof(TERM_SETUP) - 1);
+        }
+        if (sigs & SIGNAL_INT)
+            break;
 
-    while(running);;
+        // so recompoe o que mudou: o damage do layout volta para o fundo e
+        // o texto, e a lista, o status e as estatisticas mudam todo frame.
+        // So esses retangulos sao comparados com o front
+        ndirty = 0;
+        layout_update(lay);
+        if (redraw){
+            // root novo (inicio ou resize): compoe tudo
+            fill_view(root, '_');
+            dirty[ndirty++] = rect_at(0, 0, root->width, root->height);
+            redraw = 0;
+        }else{
+            for (int i = 0; lay != NULL && i < lay->ndamage; i++){
+                fill_rect(root, &lay->damage[i], '_');
+                dirty[ndirty++] = lay->damage[i];
+            }
+            // a largura das estatisticas segue a maior linha: o retangulo
+            // do frame anterior volta para o fundo antes de desenhar de novo
+            if (stats.width > 0){
+                fill_rect(root, &stats, '_');
+                dirty[ndirty++] = stats;
+            }
+        }
+        // o fundo foi preenchido de novo: o canvas nao sabe, desenha tudo
+        if (ndirty > 0)
+            braille_invalidate(plot);
+        // um pedaco da busca por frame, os matches aparecem conforme sao achados
+        found = find != NULL ? text_search_step(find, TEXT_SEARCH_CHUNK) : 0;
+        if (ndirty > 0 || found > 0){
+            render_text_to_view(txt, root);
+            render_matches_to_view(find, root);
+            dirty[ndirty++] = rect_at(txt->x, txt->y, txt->width, txt->height);
+        }
+        layout_clear_damage(lay);
+        list_select(lst, frame % DEMO_ROWS);
+        if (render_list_to_view(lst, root) != -1)
+            dirty[ndirty++] = rect_at(lst->x, lst->y, lst->width, lst->height);
+        if (plot != NULL){
+            // bytes escritos no frame anterior, a serie anda uma coluna
+            trace_last_frame(last);
+            if (nhistory == PLOT_HISTORY){
+                memmove(history, history + 1, sizeof(float) * (PLOT_HISTORY - 1));
+                nhistory--;
+            }
+            history[nhistory++] = last[TRACE_BYTES_WRITTEN];
+            n = nhistory < plot->dot_w ? nhistory : plot->dot_w;
+            float top = 1;
+            for (int i = nhistory - n; i < nhistory; i++)
+                if (history[i] > top)
+                    top = history[i];
+            braille_clear(plot);
+            braille_plot(plot, history + nhistory - n, n, 0, top);
+            if (braille_to_view(plot, root) > 0)
+                dirty[ndirty++] = rect_at(plot->x, plot->y, plot->width, plot->height);
+        }
+        dirty[ndirty] = rect_at(0, root->height - 1, root->width, 1);
+        fill_rect(root, &dirty[ndirty++], '_');
+        n = snprintf(status, sizeof(status), " frame: %ld  descartados: %ld ",
+                     frame++, out->dropped);
+        print_to_view(root, 0, root->height - 1, n, status);
+        if (getenv("TERMAL_STATS") != NULL){
+            stats = render_trace_overlay(root);
+            dirty[ndirty++] = stats;
+        }
+
+        // terminal atrasado: o frame eh descartado e o proximo leva tudo
+        output_present_rects(out, root, dirty, ndirty);
+        fb_export_publish(fb, root);
+        TRACE_FRAME();
+        sigs = 0;
+        if (output_wait(out, sig_fd, FRAME_MS))
+            sigs = signals_read(sig_fd);
+    }
 
+    output_close(out);
+    signals_close(sig_fd);
+    text_search_free(find);
+    destroy_layout(lay);
+    destroy_braille(plot);
     reset_terminal();
     fclose(f);
+    fb_export_close(fb);
     destroy_view(root);
     destroi_text(txt);
+    destroy_list(lst);
     return 0;
 }
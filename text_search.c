@@ -0,0 +1,249 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "view.h"
+#include "text_search.h"
+
+#define MAX_VISIBLE 256
+
+struct TextSearch *text_search_start(struct TextView *txt, const char *pattern){
+    struct TextSearch *s;
+    if (txt == NULL || pattern == NULL || pattern[0] == '\0')
+        return NULL;
+    if ((s = calloc(1, sizeof(struct TextSearch))) == NULL)
+        return NULL;
+    if ((s->pattern = strdup(pattern)) == NULL){
+        free(s);
+        return NULL;
+    }
+    s->txt = txt;
+    s->plen = strlen(pattern);
+    s->done = txt->text == NULL || (size_t)txt->length < s->plen;
+
+    return s;
+}
+
+struct TextSearch *text_search_free(struct TextSearch *s){
+    if (s == NULL)
+        return NULL;
+    free(s->pattern);
+    free(s->matches);
+    free(s);
+
+    return NULL;
+}
+
+// Primeiro match que comeca em [from, stop), stop <= len - plen + 1
+// retorna o offset, -1 se nao tem
+static long find_next(const char *text, size_t from, size_t stop,
+                      const char *pat, size_t plen)
+{
+    const char *p;
+    size_t i = from;
+#ifdef __SSE2__
+    const __m128i first = _mm_set1_epi8(pat[0]);
+    const __m128i last = _mm_set1_epi8(pat[plen - 1]);
+    __m128i a, b;
+    unsigned mask;
+    size_t cand;
+
+    // 32 inicios por vez: o byte do inicio e o byte do fim precisam bater
+    for (; i + 32 <= stop; i += 32){
+        a = _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i)), first),
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i + plen - 1)), last));
+        b = _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i + 16)), first),
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i + 15 + plen)), last));
+        // quase sempre nenhum candidato, um teste so para os dois blocos
+        if (_mm_movemask_epi8(_mm_or_si128(a, b)) == 0)
+            continue;
+        mask = _mm_movemask_epi8(a) | (unsigned)_mm_movemask_epi8(b) << 16;
+        while (mask != 0){
+            cand = i + __builtin_ctz(mask);
+            if (plen <= 2 || memcmp(text + cand + 1, pat + 1, plen - 2) == 0)
+                return cand;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    if (i >= stop)
+        return -1;
+    p = memmem(text + i, stop - i + plen - 1, pat, plen);
+    return p == NULL ? -1 : p - text;
+}
+
+// Conta as linhas ate offset, a partir de onde parou
+static void count_lines(struct TextSearch *s, size_t offset){
+    const char *text = s->txt->text, *p;
+    size_t cur = s->line_pos;
+#ifdef __SSE2__
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; cur + 16 <= offset; cur += 16)
+        s->line += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(
+                        _mm_loadu_si128((const __m128i *)(text + cur)), nl)));
+#endif
+    for (; cur < offset; cur++)
+        if (text[cur] == '\n')
+            s->line++;
+    if ((p = memrchr(text + s->line_pos, '\n', offset - s->line_pos)) != NULL)
+        s->line_start = p - text + 1;
+    s->line_pos = offset;
+}
+
+static int push_match(struct TextSearch *s, size_t offset){
+    struct TextMatch *tmp;
+    size_t cap;
+    if (s->nmatches == s->cap){
+        cap = s->cap == 0 ? 64 : s->cap * 2;
+        if ((tmp = realloc(s->matches, sizeof(struct TextMatch) * cap)) == NULL)
+            return -1;
+        s->matches = tmp;
+        s->cap = cap;
+    }
+    count_lines(s, offset);
+    s->matches[s->nmatches].offset = offset;
+    s->matches[s->nmatches].line = s->line;
+    s->matches[s->nmatches].col = offset - s->line_start;
+    s->nmatches++;
+    return 0;
+}
+
+// Varre [s->pos, s->pos + chunk), para no primeiro match se first_only
+static long scan(struct TextSearch *s, size_t chunk, int first_only){
+    size_t last, stop;
+    long found = 0, off = 0;
+    if (s == NULL)
+        return -1;
+    // ultimo inicio possivel + 1
+    last = s->txt->length - s->plen + 1;
+    if (s->pos >= last)
+        s->done = 1;
+    if (s->done)
+        return 0;
+
+    stop = chunk < last - s->pos ? s->pos + chunk : last;
+    while (s->pos < stop &&
+           (off = find_next(s->txt->text, s->pos, stop, s->pattern, s->plen)) != -1)
+    {
+        if (push_match(s, off) == -1)
+            return -1;
+        s->pos = off + s->plen;
+        found++;
+        if (first_only)
+            break;
+    }
+    if (off == -1)
+        s->pos = stop;
+    if (s->pos >= last)
+        s->done = 1;
+
+    return found;
+}
+
+long text_search_step(struct TextSearch *s, size_t chunk){
+    return scan(s, chunk, 0);
+}
+
+long text_search_next(struct TextSearch *s){
+    long r;
+    if (s == NULL)
+        return -1;
+    while (!s->done){
+        if ((r = scan(s, TEXT_SEARCH_CHUNK, 1)) == -1)
+            return -1;
+        if (r > 0)
+            return s->nmatches - 1;
+    }
+    return -1;
+}
+
+size_t text_search_line(struct TextSearch *s, int line){
+    size_t lo = 0, hi, mid;
+    if (s == NULL)
+        return 0;
+    hi = s->nmatches;
+    while (lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if (s->matches[mid].line < line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Junta o cell com o trecho anterior se for o seguinte na mesma linha
+static void add_cell(struct Rect *out, int *n, int max, int x, int y){
+    struct Rect *r;
+    if (*n > 0 && out[*n - 1].y == y && out[*n - 1].x + out[*n - 1].width == x){
+        out[*n - 1].width++;
+        return;
+    }
+    if (*n >= max)
+        return;
+    r = &out[(*n)++];
+    r->x = x;
+    r->y = y;
+    r->width = 1;
+    r->height = 1;
+}
+
+int text_search_visible(struct TextSearch *s, struct Rect *out, int max){
+    struct TextView *txt;
+    const char *p;
+    size_t m = 0, len;
+    int dx = 0, dy = 0, n = 0;
+    if (s == NULL || out == NULL || max <= 0)
+        return 0;
+
+    // percorre so a parte visivel do texto, com as mesmas regras do
+    // render_text_to_view, e anda pelos matches em ordem de offset
+    txt = s->txt;
+    len = txt->length;
+    for (size_t i = 0; i < len && dy < txt->height && m < s->nmatches; i++){
+        while (m < s->nmatches && s->matches[m].offset + s->plen <= i)
+            m++;
+        if (m == s->nmatches)
+            break;
+        if (txt->text[i] == '\n'){
+            dx = 0;
+            dy++;
+            continue;
+        }
+        if (!in_range(dx, 0, txt->width - 1)){
+            if (txt->wraping == NO){
+                // o resto da linha nao aparece
+                if ((p = memchr(txt->text + i, '\n', len - i)) == NULL)
+                    break;
+                i = p - txt->text - 1;
+                continue;
+            }
+            dx = 0;
+            if (++dy >= txt->height)
+                break;
+        }
+        if (s->matches[m].offset <= i)
+            add_cell(out, &n, max, txt->x + dx, txt->y + dy);
+        dx++;
+    }
+
+    return n;
+}
+
+int render_matches_to_view(struct TextSearch *s, struct BaseView *v){
+    struct Rect rects[MAX_VISIBLE];
+    int n, marked = 0;
+    if (s == NULL || v == NULL)
+        return 0;
+
+    n = text_search_visible(s, rects, MAX_VISIBLE);
+    for (int i = 0; i < n; i++)
+        marked += highlight_cells(v, rects[i].x, rects[i].y, rects[i].width);
+
+    return marked;
+}
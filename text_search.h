@@ -0,0 +1,63 @@
+#ifndef TEXT_SEARCH_H_
+#define TEXT_SEARCH_H_
+#include <stddef.h>
+#include "view.h"
+
+// Busca incremental ('/') no texto de um TextView.
+// A varredura eh feita em pedacos de no maximo chunk bytes por chamada,
+// entao a interface pode chamar uma vez por frame sem travar; os matches
+// vao para um indice com linha e coluna (do texto, sem quebra de linha).
+// Com SSE2 os candidatos sao filtrados comparando o primeiro e o ultimo
+// byte do padrao em 32 posicoes de uma vez, sem SSE2 usa memmem.
+// Os matches nao se sobrepoem.
+
+// Bytes varridos por frame
+#define TEXT_SEARCH_CHUNK (4 * 1024 * 1024)
+
+struct TextMatch {
+    size_t offset;  // em txt->text
+    int line, col;
+};
+
+struct TextSearch {
+    struct TextView *txt;
+    char *pattern;
+    size_t plen;
+    size_t pos;             // proximo offset a varrer
+    // contagem de linhas ate line_pos, so avanca ate o ultimo match
+    size_t line_pos, line_start;
+    int line;
+    struct TextMatch *matches;
+    size_t nmatches, cap;
+    int done;
+};
+
+// O texto de txt nao pode mudar enquanto a busca existir
+// retorna NULL em caso de erro
+struct TextSearch *text_search_start(struct TextView *txt, const char *pattern);
+
+struct TextSearch *text_search_free(struct TextSearch *s);
+
+// Varre ate chunk bytes a partir de onde parou
+// retorna quantos matches novos, -1 em caso de erro
+long text_search_step(struct TextSearch *s, size_t chunk);
+
+// Varre ate achar o proximo match ou acabar o texto
+// retorna o indice do match, -1 se nao tem mais
+long text_search_next(struct TextSearch *s);
+
+// retorna o indice do primeiro match na linha line ou depois,
+// s->nmatches se nao tiver (ainda)
+size_t text_search_line(struct TextSearch *s, int line);
+
+// Preenche out com os trechos dos matches visiveis na area do TextView,
+// em coordenadas da view onde ele eh desenhado, seguindo o mesmo layout
+// do render_text_to_view. Um match quebrado pelo wrap vira dois trechos
+// retorna quantos trechos foram escritos
+int text_search_visible(struct TextSearch *s, struct Rect *out, int max);
+
+// Destaca os matches visiveis em v com o CELL_HIGHLIGHT, o texto
+// desenhado continua o mesmo. Chamar depois do render_text_to_view
+// retorna quantos cells foram marcados
+int render_matches_to_view(struct TextSearch *s, struct BaseView *v);
+#endif
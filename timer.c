@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "timer.h"
+
+#define TIMER_MASK (TIMER_SLOTS - 1)
+#define NO_TICK    UINT64_MAX
+
+uint64_t timer_now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void timer_init(struct TimerWheel *w, uint64_t now_ms){
+    memset(w, 0, sizeof(*w));
+    w->now = now_ms;
+}
+
+// Coloca t no nivel mais baixo em que a parte alta de expires bate com now
+static void link_timer(struct TimerWheel *w, struct Timer *t){
+    uint64_t diff = t->expires ^ w->now;
+    int level = 0, slot;
+
+    if (diff >> TIMER_BITS)
+        level = (63 - __builtin_clzll(diff)) / TIMER_BITS;
+    // longe demais, fica no ultimo nivel e volta a descer quando o slot chegar
+    if (level >= TIMER_LEVELS)
+        level = TIMER_LEVELS - 1;
+    slot = (t->expires >> (level * TIMER_BITS)) & TIMER_MASK;
+
+    t->level = level;
+    t->slot = slot;
+    t->next = w->slots[level][slot];
+    if (t->next != NULL)
+        t->next->pprev = &t->next;
+    t->pprev = &w->slots[level][slot];
+    w->slots[level][slot] = t;
+    w->occupied[level] |= 1ull << slot;
+}
+
+static void unlink_timer(struct TimerWheel *w, struct Timer *t){
+    *t->pprev = t->next;
+    if (t->next != NULL)
+        t->next->pprev = t->pprev;
+    if (t->level >= 0 && w->slots[t->level][t->slot] == NULL)
+        w->occupied[t->level] &= ~(1ull << t->slot);
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+int timer_pending(struct Timer *t){
+    return t != NULL && t->pprev != NULL;
+}
+
+void timer_start(struct TimerWheel *w, struct Timer *t,
+                 uint64_t delay_ms, uint64_t period_ms,
+                 void (*cb)(struct Timer *t, void *arg), void *arg)
+{
+    if (w == NULL || t == NULL)
+        return;
+    if (timer_pending(t))
+        timer_cancel(w, t);
+
+    // o tick atual ja foi processado, o minimo eh o proximo
+    t->expires = w->now + (delay_ms > 0 ? delay_ms : 1);
+    t->period = period_ms;
+    t->cb = cb;
+    t->arg = arg;
+    link_timer(w, t);
+    w->count++;
+}
+
+void timer_cancel(struct TimerWheel *w, struct Timer *t){
+    if (w == NULL || !timer_pending(t))
+        return;
+    unlink_timer(w, t);
+    w->count--;
+}
+
+// Proximo tick em que algo acontece: um timer do nivel 0 expira ou
+// um slot de nivel mais alto precisa descer
+static uint64_t next_tick(struct TimerWheel *w){
+    uint64_t mask, base;
+    int shift, idx;
+
+    for (int l = 0; l < TIMER_LEVELS; l++){
+        shift = l * TIMER_BITS;
+        idx = (w->now >> shift) & TIMER_MASK;
+        mask = idx == TIMER_MASK ? 0 : w->occupied[l] & (~0ull << (idx + 1));
+        base = (w->now >> (shift + TIMER_BITS)) << (shift + TIMER_BITS);
+        if (mask)
+            return base + ((uint64_t)__builtin_ctzll(mask) << shift);
+    }
+
+    // so sobrou timer longe no ultimo nivel, o slot dele eh da proxima volta
+    shift = (TIMER_LEVELS - 1) * TIMER_BITS;
+    if (w->occupied[TIMER_LEVELS - 1]){
+        base = ((w->now >> (shift + TIMER_BITS)) + 1) << (shift + TIMER_BITS);
+        return base + ((uint64_t)__builtin_ctzll(w->occupied[TIMER_LEVELS - 1]) << shift);
+    }
+
+    return NO_TICK;
+}
+
+// Desce os timers do slot para os niveis de baixo
+static void cascade(struct TimerWheel *w, int level, int slot){
+    struct Timer *t, *list = w->slots[level][slot];
+
+    w->slots[level][slot] = NULL;
+    w->occupied[level] &= ~(1ull << slot);
+    while ((t = list) != NULL){
+        list = t->next;
+        link_timer(w, t);
+    }
+}
+
+int timer_advance(struct TimerWheel *w, uint64_t now_ms){
+    struct Timer *t, *pending;
+    uint64_t next;
+    int expired = 0, idx;
+
+    if (w == NULL)
+        return 0;
+    while (w->now < now_ms){
+        next = next_tick(w);
+        if (next > now_ms){
+            w->now = now_ms;
+            break;
+        }
+        w->now = next;
+
+        for (int l = TIMER_LEVELS - 1; l > 0; l--)
+            if ((w->now & ((1ull << (l * TIMER_BITS)) - 1)) == 0)
+                cascade(w, l, (w->now >> (l * TIMER_BITS)) & TIMER_MASK);
+
+        // tira a lista do slot, os callbacks podem cancelar ou agendar timers
+        idx = w->now & TIMER_MASK;
+        pending = w->slots[0][idx];
+        w->slots[0][idx] = NULL;
+        w->occupied[0] &= ~(1ull << idx);
+        if (pending != NULL)
+            pending->pprev = &pending;
+        for (t = pending; t != NULL; t = t->next)
+            t->level = -1;
+
+        while ((t = pending) != NULL){
+            unlink_timer(w, t);
+            if (t->period > 0){
+                t->expires = w->now + t->period;
+                link_timer(w, t);
+            }else{
+                w->count--;
+            }
+            expired++;
+            t->cb(t, t->arg);
+        }
+    }
+
+    return expired;
+}
+
+int timer_timeout(struct TimerWheel *w, uint64_t now_ms){
+    uint64_t next;
+    if (w == NULL || w->count == 0)
+        return -1;
+    next = next_tick(w);
+    if (next == NO_TICK)
+        return -1;
+    if (next <= now_ms)
+        return 0;
+    if (next - now_ms > INT_MAX)
+        return INT_MAX;
+    return next - now_ms;
+}
@@ -0,0 +1,56 @@
+#ifndef TIMER_H_
+#define TIMER_H_
+#include <stdint.h>
+
+// Timing wheel hierarquico: TIMER_LEVELS niveis de TIMER_SLOTS slots.
+// O nivel 0 tem resolucao de 1 tick (1 ms), cada nivel acima cobre
+// TIMER_SLOTS vezes mais. Um timer fica no nivel mais baixo em que a
+// parte alta do expires bate com a do tick atual, entao o slot do nivel 0
+// so tem timers que expiram exatamente naquele tick.
+// Inserir, cancelar e expirar sao O(1); os niveis altos descem
+// (cascade) quando o indice do nivel de baixo da a volta.
+
+#define TIMER_BITS   6
+#define TIMER_SLOTS  (1 << TIMER_BITS)
+#define TIMER_LEVELS 4
+
+struct Timer {
+    struct Timer *next;
+    struct Timer **pprev;   // NULL se nao estiver agendado
+    int level, slot;        // -1 enquanto esta sendo expirado
+    uint64_t expires;       // em ticks
+    uint64_t period;        // 0 = uma vez so
+    void (*cb)(struct Timer *t, void *arg);
+    void *arg;
+};
+
+struct TimerWheel {
+    uint64_t now;
+    struct Timer *slots[TIMER_LEVELS][TIMER_SLOTS];
+    uint64_t occupied[TIMER_LEVELS];    // bit i = slot i tem timers
+    int count;
+};
+
+// Tempo atual em ms (CLOCK_MONOTONIC)
+uint64_t timer_now_ms(void);
+
+void timer_init(struct TimerWheel *w, uint64_t now_ms);
+
+// Agenda t para daqui a delay_ms, se period_ms > 0 repete a cada period_ms
+// Se t ja estiver agendado eh reagendado
+void timer_start(struct TimerWheel *w, struct Timer *t,
+                 uint64_t delay_ms, uint64_t period_ms,
+                 void (*cb)(struct Timer *t, void *arg), void *arg);
+
+void timer_cancel(struct TimerWheel *w, struct Timer *t);
+
+// retorna 1 se t esta agendado
+int timer_pending(struct Timer *t);
+
+// Avanca ate now_ms chamando os callbacks dos timers que expiraram
+// retorna quantos expiraram
+int timer_advance(struct TimerWheel *w, uint64_t now_ms);
+
+// ms ate o proximo deadline (para o poll), -1 se nao tem timers
+int timer_timeout(struct TimerWheel *w, uint64_t now_ms);
+#endif
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+
+#define TRACE_PATH_SZ 256
+
+static struct TraceRecord ring[TRACE_RING_SZ];
+static _Atomic uint64_t ringHead = 0;
+_Atomic uint64_t trace_counters[TRACE_N];
+static uint64_t lastSnapshot[TRACE_N];
+static _Atomic uint64_t lastFrame[TRACE_N];
+static char dumpPath[TRACE_PATH_SZ];
+
+static const char *names[TRACE_N] = {
+    [TRACE_CELLS_DIFFED]     = "cells diffed",
+    [TRACE_CELLS_EMITTED]    = "cells emitted",
+    [TRACE_BYTES_WRITTEN]    = "bytes written",
+    [TRACE_SYSCALLS]         = "syscalls",
+    [TRACE_INPUT_BYTES]      = "input bytes",
+    [TRACE_EVENTS_COALESCED] = "events coalesced",
+    [TRACE_PARSE_NS]         = "parse ns",
+    [TRACE_RENDER_NS]        = "render ns",
+    [TRACE_FRAMES]           = "frames",
+    [TRACE_FRAMES_DROPPED]   = "frames dropped",
+};
+
+uint64_t trace_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void trace_add(int type, uint64_t value){
+    struct TraceRecord *r;
+    uint64_t idx;
+    if (type < 0 || type >= TRACE_N)
+        return;
+
+    atomic_fetch_add_explicit(&trace_counters[type], value, memory_order_relaxed);
+
+    // Cada produtor reserva um slot, o seq eh escrito por ultimo para
+    // que o leitor saiba se o registro esta completo
+    idx = atomic_fetch_add_explicit(&ringHead, 1, memory_order_relaxed);
+    r = &ring[idx & (TRACE_RING_SZ - 1)];
+    atomic_store_explicit((_Atomic uint64_t *)&r->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    r->ts = trace_now();
+    r->type = type;
+    r->value = value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+    atomic_store_explicit((_Atomic uint64_t *)&r->seq, idx + 1, memory_order_release);
+}
+
+void trace_frame(void){
+    uint64_t now;
+    trace_add(TRACE_FRAMES, 1);
+    for (int i = 0; i < TRACE_N; i++){
+        now = atomic_load_explicit(&trace_counters[i], memory_order_relaxed);
+        atomic_store_explicit(&lastFrame[i], now - lastSnapshot[i], memory_order_relaxed);
+        lastSnapshot[i] = now;
+    }
+}
+
+void trace_snapshot(uint64_t out[TRACE_N]){
+    for (int i = 0; i < TRACE_N; i++)
+        out[i] = atomic_load_explicit(&trace_counters[i], memory_order_relaxed);
+}
+
+void trace_last_frame(uint64_t out[TRACE_N]){
+    for (int i = 0; i < TRACE_N; i++)
+        out[i] = atomic_load_explicit(&lastFrame[i], memory_order_relaxed);
+}
+
+const char *trace_name(int type){
+    if (type < 0 || type >= TRACE_N)
+        return "?";
+    return names[type];
+}
+
+static int write_all(int fd, const void *buf, size_t sz){
+    const char *p = buf;
+    ssize_t w;
+    while (sz > 0){
+        if ((w = write(fd, p, sz)) == -1)
+            return -1;
+        p += w;
+        sz -= w;
+    }
+    return 0;
+}
+
+// Copia o registro i do ring, 0 se ele foi sobrescrito antes ou durante
+// a copia (seq diferente antes e depois)
+static int copy_record(uint64_t i, struct TraceRecord *out){
+    struct TraceRecord *r = &ring[i & (TRACE_RING_SZ - 1)];
+    uint64_t seq;
+    seq = atomic_load_explicit((_Atomic uint64_t *)&r->seq, memory_order_acquire);
+    if (seq != i + 1)
+        return 0;
+    out->seq = seq;
+    out->ts = r->ts;
+    out->type = r->type;
+    out->value = r->value;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit((_Atomic uint64_t *)&r->seq, memory_order_relaxed) == seq;
+}
+
+int trace_dump_fd(int fd){
+    // estatico: o dump pode rodar em um signal handler, sem malloc
+    static struct TraceRecord records[TRACE_RING_SZ];
+    struct TraceHeader hdr;
+    uint64_t snap[TRACE_N];
+    uint64_t head, first;
+    uint32_t n = 0;
+
+    // copia primeiro, o cabecalho leva quantos registros sobraram inteiros
+    head = atomic_load_explicit(&ringHead, memory_order_acquire);
+    first = head > TRACE_RING_SZ ? head - TRACE_RING_SZ : 0;
+    for (uint64_t i = first; i < head; i++)
+        if (copy_record(i, &records[n]))
+            n++;
+
+    memcpy(hdr.magic, TRACE_MAGIC, 4);
+    hdr.version = TRACE_VERSION;
+    hdr.ncounters = TRACE_N;
+    hdr.nrecords = n;
+    trace_snapshot(snap);
+    if (write_all(fd, &hdr, sizeof(hdr)) == -1 ||
+        write_all(fd, snap, sizeof(snap)) == -1 ||
+        write_all(fd, records, sizeof(struct TraceRecord) * n) == -1)
+        return -1;
+
+    return 0;
+}
+
+int trace_dump(const char *path){
+    int fd, r;
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+        return -1;
+    r = trace_dump_fd(fd);
+    close(fd);
+    return r;
+}
+
+static void dump_at_exit(void){
+    trace_dump(dumpPath);
+}
+
+static void dump_on_signal(int sig){
+    int saved = errno;
+    (void)sig;
+    trace_dump(dumpPath);
+    errno = saved;
+}
+
+static void set_path(const char *path){
+    strncpy(dumpPath, path, TRACE_PATH_SZ - 1);
+    dumpPath[TRACE_PATH_SZ - 1] = '\0';
+}
+
+void trace_dump_on_exit(const char *path){
+    set_path(path);
+    atexit(dump_at_exit);
+}
+
+int trace_dump_on_signal(int sig, const char *path){
+    struct sigaction sa;
+    set_path(path);
+    sa.sa_handler = dump_on_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    return sigaction(sig, &sa, NULL);
+}
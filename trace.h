@@ -0,0 +1,109 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Instrumentacao de baixo custo.
+// Cada evento soma em um contador global e grava um registro binario
+// em um ring em memoria (lock-free, sobrescreve os mais antigos).
+// TRACE_COUNT so soma no contador, sem relogio nem registro, para o que
+// acontece por byte ou por syscall.
+// Compilar com -DNTRACE remove todas as chamadas dos macros TRACE*.
+
+// Tamanho do ring, precisa ser potencia de 2
+#define TRACE_RING_SZ 4096
+#define TRACE_MAGIC   "TTRC"
+#define TRACE_VERSION 1
+
+enum TraceType {
+    TRACE_CELLS_DIFFED,
+    TRACE_CELLS_EMITTED,
+    TRACE_BYTES_WRITTEN,
+    TRACE_SYSCALLS,
+    TRACE_INPUT_BYTES,
+    TRACE_EVENTS_COALESCED,
+    TRACE_PARSE_NS,
+    TRACE_RENDER_NS,
+    TRACE_FRAMES,
+    TRACE_FRAMES_DROPPED,
+    TRACE_N
+};
+
+struct TraceRecord {
+    uint64_t seq;   // indice global + 1, 0 = slot nunca escrito
+    uint64_t ts;    // CLOCK_MONOTONIC em ns
+    uint32_t type;
+    uint32_t value;
+};
+
+// Formato do arquivo de dump:
+// struct TraceHeader
+// uint64_t counters[ncounters]
+// struct TraceRecord records[nrecords] (do mais antigo ao mais novo)
+struct TraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t ncounters;
+    uint32_t nrecords;
+};
+
+// Contadores totais, lidos com trace_snapshot
+extern _Atomic uint64_t trace_counters[TRACE_N];
+
+#ifdef NTRACE
+// sizeof nao avalia value, so evita o aviso de variavel nao usada
+#define TRACE(type, value)        ((void)sizeof(value))
+#define TRACE_COUNT(type, value)  ((void)sizeof(value))
+#define TRACE_BEGIN(var)          ((void)0)
+#define TRACE_END(type, var)      ((void)0)
+#define TRACE_FRAME()             ((void)0)
+#define TRACE_MARK(var)           ((void)(var))
+#define TRACE_SINCE(type, var)    ((void)(var))
+#else
+#define TRACE(type, value)        trace_add((type), (value))
+// load e store relaxed em vez de um add atomico: cada tipo contado assim
+// so pode ser somado por uma thread
+#define TRACE_COUNT(type, value)                                            \
+    atomic_store_explicit(&trace_counters[type],                            \
+        atomic_load_explicit(&trace_counters[type], memory_order_relaxed)   \
+        + (value), memory_order_relaxed)
+#define TRACE_BEGIN(var)          uint64_t var = trace_now()
+#define TRACE_END(type, var)      trace_add((type), trace_now() - (var))
+#define TRACE_FRAME()             trace_frame()
+// TRACE_BEGIN/TRACE_END com uma variavel que ja existe, para medidas que
+// comecam e terminam em chamadas diferentes
+#define TRACE_MARK(var)           ((var) = trace_now())
+#define TRACE_SINCE(type, var)    trace_add((type), trace_now() - (var))
+#endif
+
+uint64_t trace_now(void);
+
+// Soma value no contador type e grava um registro no ring
+void trace_add(int type, uint64_t value);
+
+// Marca o fim de um frame, guarda a diferenca dos contadores
+// desde o frame anterior (ver trace_last_frame)
+void trace_frame(void);
+
+// Copia os contadores totais para out
+void trace_snapshot(uint64_t out[TRACE_N]);
+
+// Copia os contadores do ultimo frame completo para out
+void trace_last_frame(uint64_t out[TRACE_N]);
+
+const char *trace_name(int type);
+
+// Escreve o dump em fd, usa apenas write (async-signal-safe)
+// retorna -1 em caso de erro
+int trace_dump_fd(int fd);
+
+// retorna -1 em caso de erro
+int trace_dump(const char *path);
+
+// Faz o dump em path quando o programa terminar (atexit)
+void trace_dump_on_exit(const char *path);
+
+// Faz o dump em path sempre que receber sig
+// retorna -1 em caso de erro
+int trace_dump_on_signal(int sig, const char *path);
+#endif
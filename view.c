@@ -0,0 +1,707 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "trace.h"
+#include "view.h"
+
+// Utils //
+void clamp_int(int *x, int min, int max){
+    if (*x > max) *x = max;
+    if (*x < min) *x = min;
+}
+
+int in_range(int x, int a, int b){
+    return (x >= a && x <= b);
+}
+
+int is_printable_char(char c){
+    return (' ' <= c && c <= '~');
+}
+// Utils //
+
+// View //
+// Rows //
+static struct Row *row_new(int width){
+    struct Row *r = malloc(sizeof(struct Row));
+    if (r == NULL)
+        return NULL;
+    if ((r->cells = malloc(sizeof(char) * width)) == NULL){
+        free(r);
+        return NULL;
+    }
+    r->refs = 1;
+    return r;
+}
+
+static struct Row *row_get(struct Row *r){
+    r->refs++;
+    return r;
+}
+
+static void row_put(struct Row *r){
+    if (r == NULL || --r->refs > 0)
+        return;
+    free(r->cells);
+    free(r);
+}
+
+// Linha uniforme com c, uma por caracter na view
+static struct Row *fill_row(struct RowStore *st, char c){
+    struct Row **r = &st->fills[(unsigned char)c];
+    if (*r == NULL){
+        if ((*r = row_new(st->width)) == NULL)
+            return NULL;
+        memset((*r)->cells, c, st->width);
+    }
+    return *r;
+}
+
+const char *view_row(struct BaseView *vw, int y){
+    if (vw->mode == VIEW_ROWS)
+        return vw->store->rows[vw->off_y + y]->cells + vw->off_x;
+    return &vw->buffer[y * vw->stride];
+}
+
+char *view_row_mut(struct BaseView *vw, int y){
+    struct Row *r, *copy;
+    struct RowStore *st = vw->store;
+    if (vw->mode != VIEW_ROWS)
+        return &vw->buffer[y * vw->stride];
+
+    y += vw->off_y;
+    r = st->rows[y];
+    // copy-on-write: a linha eh de mais alguem (outra linha ou a tabela de fills)
+    if (r->refs > 1){
+        if ((copy = row_new(st->width)) == NULL)
+            return NULL;
+        memcpy(copy->cells, r->cells, st->width);
+        row_put(r);
+        st->rows[y] = r = copy;
+    }
+    return r->cells + vw->off_x;
+}
+// Rows //
+
+void fill_view(struct BaseView *vw, char c){
+    struct Row *r;
+    char *row;
+    // view cobre a linha inteira: todas passam a ser a mesma, sem copiar nada
+    if (vw->mode == VIEW_ROWS && vw->width == vw->store->width){
+        if ((r = fill_row(vw->store, c)) == NULL)
+            return;
+        for (int i = vw->off_y; i < vw->off_y + vw->height; i++){
+            row_put(vw->store->rows[i]);
+            vw->store->rows[i] = row_get(r);
+        }
+        return;
+    }
+    for (int i = 0; i < vw->height; i++){
+        if ((row = view_row_mut(vw, i)) == NULL)
+            return;
+        memset(row, c, vw->width);
+    }
+}
+
+void fill_rect(struct BaseView *vw, const struct Rect *r, char c){
+    int x0, y0, x1, y1;
+    char *row;
+    if (vw == NULL || r == NULL)
+        return;
+    x0 = r->x < 0 ? 0 : r->x;
+    y0 = r->y < 0 ? 0 : r->y;
+    x1 = r->x + r->width > vw->width ? vw->width : r->x + r->width;
+    y1 = r->y + r->height > vw->height ? vw->height : r->y + r->height;
+    for (int y = y0; y < y1 && x0 < x1; y++){
+        if ((row = view_row_mut(vw, y)) == NULL)
+            return;
+        memset(row + x0, c, x1 - x0);
+    }
+}
+
+struct BaseView *create_view(int width, int height, int x, int y){
+    struct BaseView *vw = malloc(sizeof(struct BaseView));
+
+    if (vw == NULL)
+        return NULL;
+
+    if ((vw->buffer = malloc(sizeof(char) * width * height)) == NULL){
+        free(vw);
+        return NULL;
+    }
+
+    vw->width = width;
+    vw->height = height;
+    vw->x = x;
+    vw->y = y;
+    vw->stride = width;
+    vw->mode = VIEW_DENSE;
+    vw->store = NULL;
+    vw->parent = NULL;
+    vw->off_x = vw->off_y = 0;
+    fill_view(vw, ' ');
+
+    return vw;
+}
+
+struct BaseView *create_rows_view(int width, int height, int x, int y){
+    struct BaseView *vw;
+    struct Row *blank;
+
+    if (width <= 0 || height <= 0)
+        return NULL;
+    if ((vw = calloc(1, sizeof(struct BaseView))) == NULL)
+        return NULL;
+    vw->width = width;
+    vw->height = height;
+    vw->x = x;
+    vw->y = y;
+    vw->mode = VIEW_ROWS;
+    vw->buffer = NULL;
+    if ((vw->store = calloc(1, sizeof(struct RowStore))) != NULL)
+        vw->store->width = width;
+    if (vw->store == NULL ||
+        (vw->store->rows = malloc(sizeof(struct Row *) * height)) == NULL ||
+        (blank = fill_row(vw->store, ' ')) == NULL)
+    {
+        if (vw->store != NULL)
+            free(vw->store->rows);
+        free(vw->store);
+        free(vw);
+        return NULL;
+    }
+    for (int i = 0; i < height; i++)
+        vw->store->rows[i] = row_get(blank);
+
+    return vw;
+}
+
+struct BaseView *create_subview(struct BaseView *parent, int off_x, int off_y,
+                                int width, int height)
+{
+    struct BaseView *vw;
+    if (parent == NULL || width <= 0 || height <= 0 ||
+        off_x < 0 || off_y < 0 ||
+        off_x + width > parent->width || off_y + height > parent->height)
+        return NULL;
+    if ((vw = calloc(1, sizeof(struct BaseView))) == NULL)
+        return NULL;
+
+    vw->width = width;
+    vw->height = height;
+    vw->mode = parent->mode;
+    vw->stride = parent->stride;
+    vw->store = parent->store;
+    // sempre referencia o dono da memoria, com offsets absolutos
+    vw->parent = parent->parent != NULL ? parent->parent : parent;
+    vw->base_x = parent->off_x;
+    vw->base_y = parent->off_y;
+    vw->base_w = parent->width;
+    vw->base_h = parent->height;
+    move_subview(vw, off_x, off_y);
+
+    return vw;
+}
+
+void move_subview(struct BaseView *vw, int off_x, int off_y){
+    if (vw == NULL || vw->parent == NULL)
+        return;
+    // limita ao parent direto, nao ao dono da memoria
+    clamp_int(&off_x, 0, vw->base_w - vw->width);
+    clamp_int(&off_y, 0, vw->base_h - vw->height);
+    vw->off_x = vw->base_x + off_x;
+    vw->off_y = vw->base_y + off_y;
+    if (vw->mode == VIEW_DENSE)
+        vw->buffer = vw->parent->buffer + vw->off_y * vw->stride + vw->off_x;
+}
+
+struct BaseView *destroy_view(struct BaseView *vw){
+    // subview nao tem memoria propria
+    if (vw->parent != NULL){
+        free(vw);
+        return NULL;
+    }
+    if (vw->mode == VIEW_ROWS){
+        for (int i = 0; i < vw->height; i++)
+            row_put(vw->store->rows[i]);
+        for (int i = 0; i < 256; i++)
+            row_put(vw->store->fills[i]);
+        free(vw->store->rows);
+        free(vw->store);
+    }
+    free(vw->buffer);
+    free(vw);
+
+    return NULL;
+}
+
+static uint64_t hash_row(const char *cells, int width){
+    uint64_t h = 1469598103934665603ull;
+    for (int i = 0; i < width; i++)
+        h = (h ^ (unsigned char)cells[i]) * 1099511628211ull;
+    return h;
+}
+
+static int is_uniform(const char *cells, int width){
+    for (int i = 1; i < width; i++)
+        if (cells[i] != cells[0])
+            return 0;
+    return 1;
+}
+
+int compact_view(struct BaseView *vw){
+    struct Row **table, *r, *other;
+    int sz, slot, freed = 0;
+
+    if (vw == NULL || vw->mode != VIEW_ROWS || vw->parent != NULL)
+        return 0;
+    sz = 1;
+    while (sz < vw->height * 2)
+        sz *= 2;
+    if ((table = calloc(sz, sizeof(struct Row *))) == NULL)
+        return -1;
+
+    for (int y = 0; y < vw->height; y++){
+        r = vw->store->rows[y];
+        // linha uniforme volta a ser a linha internada
+        if (is_uniform(r->cells, vw->width) &&
+            vw->store->fills[(unsigned char)r->cells[0]] != r &&
+            (other = fill_row(vw->store, r->cells[0])) != NULL)
+        {
+            if (r->refs == 1)
+                freed++;
+            row_put(r);
+            vw->store->rows[y] = row_get(other);
+            continue;
+        }
+        slot = hash_row(r->cells, vw->width) & (sz - 1);
+        while ((other = table[slot]) != NULL){
+            if (other == r || memcmp(other->cells, r->cells, vw->width) == 0)
+                break;
+            slot = (slot + 1) & (sz - 1);
+        }
+        if (other == NULL){
+            table[slot] = r;
+        }else if (other != r){
+            if (r->refs == 1)
+                freed++;
+            row_put(r);
+            vw->store->rows[y] = row_get(other);
+        }
+    }
+    free(table);
+
+    return freed;
+}
+
+size_t view_memory(struct BaseView *vw){
+    double rows = 0, row_sz;
+    if (vw == NULL)
+        return 0;
+    if (vw->parent != NULL)
+        return sizeof(struct BaseView);
+    if (vw->mode != VIEW_ROWS)
+        return sizeof(struct BaseView) + (size_t)vw->width * vw->height;
+
+    // linha compartilhada conta uma vez so: cada referencia soma 1/refs
+    row_sz = sizeof(struct Row) + vw->width;
+    for (int y = 0; y < vw->height; y++)
+        rows += row_sz / vw->store->rows[y]->refs;
+    for (int i = 0; i < 256; i++)
+        if (vw->store->fills[i] != NULL)
+            rows += row_sz / vw->store->fills[i]->refs;
+    return sizeof(struct BaseView) + sizeof(struct RowStore) +
+           sizeof(struct Row *) * vw->height + (size_t)(rows + 0.5);
+}
+
+// return 1 se conseguir setar o valor
+int set_value(struct BaseView *vw, int x, int y, char value){
+    char *row;
+    if (vw == NULL ||
+       !in_range(x, 0, vw->width-1) || !in_range(y, 0, vw->height-1)
+    )
+        return 0;
+    // evita copiar uma linha compartilhada sem mudar nada
+    if (view_row(vw, y)[x] == value)
+        return 1;
+    if ((row = view_row_mut(vw, y)) == NULL)
+        return 0;
+    row[x] = value;
+    return 1;
+}
+
+int highlight_cells(struct BaseView *vw, int x, int y, int n){
+    int marked = 0;
+    char c;
+    if (vw == NULL || !in_range(y, 0, vw->height - 1))
+        return 0;
+    for (int k = x < 0 ? 0 : x; k < x + n && k < vw->width; k++){
+        c = view_row(vw, y)[k];
+        marked += set_value(vw, k, y, (char)(c | CELL_HIGHLIGHT));
+    }
+    return marked;
+}
+
+// Joga o buffer de vw em vw2->buffer
+// retorna -1 se tiver erro
+int render_vw_to_view(struct BaseView *vw, struct BaseView *vw2){
+    int x = 0;
+    int y = 0;
+    int rendered = 0;
+    char value, *dst;
+    const char *src, *cur;
+    if (vw == NULL || vw2 == NULL)
+        return -1;
+
+    for (int i = 0; i < vw->height; i++){
+        // y relativo a vw
+        y = vw->y + i;
+        if (!in_range(y, 0, vw2->height - 1))
+            continue;
+        src = view_row(vw, i);
+        cur = view_row(vw2, y);
+        // so pede a linha para escrita se algum cell mudar
+        dst = NULL;
+        for (int j = 0; j < vw->width; j++){
+            // x relativo a vw
+            x = vw->x + j;
+            // Pega o valor no buffer vw, para jogar em vw2
+            value = src[j];
+            if (value != TRANSPARENT_PIXEL &&
+                in_range(x, 0, vw2->width - 1))
+            {
+                if (cur[x] != value){
+                    if (dst == NULL && (cur = dst = view_row_mut(vw2, y)) == NULL)
+                        return -1;
+                    dst[x] = value;
+                }
+                rendered++;
+            }
+        }
+    }
+
+    return rendered;
+}
+
+// Imprime um texto no buffer de vw
+// retorna -1 se algo der errado, caso contratio quantos valores foram impressos
+int print_to_view(struct BaseView *vw, int x_off, int y_off,
+                           int txt_sz, char *txt)
+{
+    char v;
+    int x = x_off, y = y_off;
+    int rendered = 0;
+    if (vw == NULL)
+        return -1;
+
+    for (int i = 0; i < txt_sz; i++){
+        v = txt[i];
+        if (v == TRANSPARENT_PIXEL){
+            x++;
+        }else if (v == '\n'){
+            y++;
+            x = x_off;
+        }else if (is_printable_char(v)){
+            if (in_range(x, 0, vw->width - 1) && in_range(y, 0, vw->height - 1)){
+                set_value(vw, x, y, v);
+                x++;
+                rendered++;
+            }
+        }else{
+            fprintf(stderr, "[ERRO]: Carcater com codigo '%d' nao suportado\n", (int)v);
+            return rendered;
+        }
+
+    }
+
+    return rendered;
+}
+
+void render_view(struct BaseView *vw){
+    const char *row;
+    if (vw == NULL)
+        return;
+
+    TRACE_BEGIN(t0);
+    for (int y = 0; y < vw->height - 1; y++){
+        // o bit de atributo nao eh um caracter, sai so o caracter
+        row = view_row(vw, y);
+        for (int x = 0; x < vw->width; x++)
+            putchar(CELL_CHAR(row[x]));
+        putchar('\n');
+    }
+    TRACE(TRACE_CELLS_EMITTED, vw->width * (vw->height - 1));
+    TRACE_END(TRACE_RENDER_NS, t0);
+    TRACE_FRAME();
+}
+
+int outbuf_append(struct OutBuf *ob, const char *s, size_t n){
+    size_t cap;
+    char *tmp;
+    if (ob->len + n > ob->cap){
+        cap = ob->cap == 0 ? 4096 : ob->cap;
+        while (cap < ob->len + n)
+            cap *= 2;
+        if ((tmp = realloc(ob->data, cap)) == NULL)
+            return -1;
+        ob->data = tmp;
+        ob->cap = cap;
+    }
+    memcpy(ob->data + ob->len, s, n);
+    ob->len += n;
+    return 0;
+}
+
+void outbuf_free(struct OutBuf *ob){
+    free(ob->data);
+    ob->data = NULL;
+    ob->len = ob->cap = 0;
+}
+
+int outbuf_append_cells(struct OutBuf *ob, const char *cells, int n){
+    int hl = 0, start = 0;
+    size_t len;
+    for (int k = 0; k <= n; k++){
+        if (k < n && ((cells[k] & CELL_HIGHLIGHT) != 0) == hl)
+            continue;
+        // trecho [start, k) com o mesmo atributo, sem o bit alto
+        len = ob->len;
+        if (outbuf_append(ob, &cells[start], k - start) == -1)
+            return -1;
+        for (size_t i = len; i < ob->len; i++)
+            ob->data[i] = CELL_CHAR(ob->data[i]);
+        if (k < n || hl){
+            hl = !hl;
+            if (outbuf_append(ob, hl ? "\x1b[7m" : "\x1b[27m", hl ? 4 : 5) == -1)
+                return -1;
+        }
+        start = k;
+    }
+    return 0;
+}
+
+// Cell como ele aparece no terminal, o atributo fica
+static char out_cell(char c){
+    return CELL_CHAR(c) == TRANSPARENT_PIXEL ? (char)((c & CELL_HIGHLIGHT) | ' ') : c;
+}
+
+// Compara o trecho [x0, x1) da linha y e escreve em ob o que mudou
+// retorna quantos cells mudaram, -1 se tiver erro
+static int diff_span(struct BaseView *front, struct BaseView *back,
+                     int y, int x0, int x1, struct OutBuf *ob)
+{
+    char seq[32], *f;
+    const char *b;
+    int x, end, n, changed = 0;
+    if ((f = view_row_mut(front, y)) == NULL)
+        return -1;
+    b = view_row(back, y);
+    x = x0;
+    while (x < x1){
+        if (f[x] == out_cell(b[x])){
+            x++;
+            continue;
+        }
+        // estende o trecho enquanto o proximo cell diferente estiver
+        // perto, reescrever poucos cells iguais sai mais barato que mover o cursor
+        end = x + 1;
+        for (int k = end; k < x1 && k - end < DIFF_GAP; k++)
+            if (f[k] != out_cell(b[k]))
+                end = k + 1;
+
+        n = snprintf(seq, sizeof(seq), "\x1b[%d;%dH", y + 1, x + 1);
+        if (outbuf_append(ob, seq, n) == -1)
+            return -1;
+        for (int k = x; k < end; k++){
+            if (f[k] != out_cell(b[k]))
+                changed++;
+            f[k] = out_cell(b[k]);
+        }
+        if (outbuf_append_cells(ob, &f[x], end - x) == -1)
+            return -1;
+        TRACE(TRACE_CELLS_EMITTED, end - x);
+        x = end;
+    }
+    return changed;
+}
+
+int diff_view(struct BaseView *front, struct BaseView *back, struct OutBuf *ob){
+    int w, h, n, changed = 0;
+    if (front == NULL || back == NULL || ob == NULL)
+        return -1;
+
+    TRACE_BEGIN(t0);
+    w = front->width < back->width ? front->width : back->width;
+    h = front->height < back->height ? front->height : back->height;
+    for (int y = 0; y < h; y++){
+        if ((n = diff_span(front, back, y, 0, w, ob)) == -1)
+            return -1;
+        changed += n;
+    }
+    TRACE(TRACE_CELLS_DIFFED, w * h);
+    TRACE_END(TRACE_RENDER_NS, t0);
+
+    return changed;
+}
+
+int diff_view_rects(struct BaseView *front, struct BaseView *back,
+                    const struct Rect *rects, int nrects, struct OutBuf *ob)
+{
+    int w, h, x0, y0, x1, y1, n, changed = 0;
+    long diffed = 0;
+    if (front == NULL || back == NULL || ob == NULL || (rects == NULL && nrects > 0))
+        return -1;
+
+    TRACE_BEGIN(t0);
+    w = front->width < back->width ? front->width : back->width;
+    h = front->height < back->height ? front->height : back->height;
+    for (int i = 0; i < nrects; i++){
+        x0 = rects[i].x < 0 ? 0 : rects[i].x;
+        y0 = rects[i].y < 0 ? 0 : rects[i].y;
+        x1 = rects[i].x + rects[i].width > w ? w : rects[i].x + rects[i].width;
+        y1 = rects[i].y + rects[i].height > h ? h : rects[i].y + rects[i].height;
+        for (int y = y0; y < y1 && x0 < x1; y++){
+            // retangulos sobrepostos: a segunda passada ja acha tudo igual
+            if ((n = diff_span(front, back, y, x0, x1, ob)) == -1)
+                return -1;
+            changed += n;
+            diffed += x1 - x0;
+        }
+    }
+    TRACE(TRACE_CELLS_DIFFED, diffed);
+    TRACE_END(TRACE_RENDER_NS, t0);
+
+    return changed;
+}
+
+// Desenha as estatisticas do trace no canto superior direito de vw
+// Cada linha mostra o valor do ultimo frame e o total
+struct Rect render_trace_overlay(struct BaseView *vw){
+    char lines[TRACE_N][64];
+    uint64_t total[TRACE_N], frame[TRACE_N];
+    struct Rect r = {0};
+    int w = 0, x, n;
+    if (vw == NULL)
+        return r;
+
+    trace_snapshot(total);
+    trace_last_frame(frame);
+    // a largura eh a da maior linha, limitada a view
+    for (int i = 0; i < TRACE_N; i++){
+        n = snprintf(lines[i], sizeof(lines[i]), "%-16s %10llu %10llu",
+                trace_name(i),
+                (unsigned long long)frame[i],
+                (unsigned long long)total[i]);
+        if (n > (int)sizeof(lines[i]) - 1)
+            n = sizeof(lines[i]) - 1;
+        if (n > w)
+            w = n;
+    }
+    if (w > vw->width)
+        w = vw->width;
+    x = vw->width - w;
+    for (int i = 0; i < TRACE_N; i++){
+        // completa as linhas menores para cobrir o retangulo todo
+        n = strlen(lines[i]);
+        if (n < w)
+            memset(lines[i] + n, ' ', w - n);
+        print_to_view(vw, x, i, w, lines[i]);
+    }
+    r.x = x;
+    r.width = w;
+    r.height = TRACE_N;
+    return r;
+}
+// View //
+
+// Text //
+struct TextView *create_text(int width, int height, int x, int y){
+    struct TextView *txt = calloc(1, sizeof(struct TextView));
+
+    if (txt == NULL)
+        return NULL;
+
+    txt->width = width;
+    txt->height = height;
+    txt->x = x;
+    txt->y = y;
+    txt->alignment = LEFT;
+    txt->wraping = NO;
+    txt->bg = '.';
+    txt->length = 0;
+
+    return txt;
+}
+// TODO: melhor forma de retornar
+char *load_text(struct TextView *txt, const char *text){
+    if (txt == NULL)
+        return NULL;
+    txt->length = strlen(text);
+    txt->text = strdup(text);
+    if (txt->text == NULL)
+        return NULL;
+    return txt->text;
+}
+
+struct TextView *destroi_text(struct TextView *txt){
+    if (txt == NULL)
+        return NULL;
+    if (txt->text != NULL)
+        free(txt->text);
+    free(txt);
+
+    return NULL;
+}
+
+// TODO: melhor forma de retornar
+void render_text_to_view(struct TextView *txt, struct BaseView *v){
+    int dx, dy, x, y;
+    dx = dy = 0;
+    if (txt == NULL || v == NULL)
+        return;
+    TRACE_BEGIN(t0);
+    x = txt->x;
+    y = txt->y;
+    for (int i = 0; i < txt->height; i++)
+        for (int j = 0; j < txt->width; j++)
+            set_value(v, x + j, y + i, txt->bg);
+    switch (txt->wraping){
+        case NO:
+            for (int i = 0; i < txt->length; i++){
+                if (txt->text[i] == '\n'){
+                    dx = 0;
+                    dy++;
+                }
+                // TODO: verificar se x + dx e y + dy estao dentro da view
+                else if (in_range(dx, 0, txt->width-1) &&
+                    in_range(dy, 0, txt->height-1))
+                {
+                    set_value(v, x + dx, y + dy, txt->text[i]);
+                    dx++;
+                }
+            }
+            break;
+        case YES:
+            for (int i = 0; i < txt->length; i++){
+                if (txt->text[i] == '\n'){
+                    dx = 0;
+                    dy++;
+                }
+                // TODO: verificar se x + dx e y + dy estao dentro da view
+                else{
+                    if (!in_range(dx, 0, txt->width-1)){
+                        dx = 0;
+                        dy++;
+                    }
+                    if (in_range(dy, 0, txt->height-1)){
+                        set_value(v, x + dx, y + dy, txt->text[i]);
+                        dx++;
+                    }
+                }
+            }
+            break;
+        default: break;
+    }
+    TRACE_END(TRACE_RENDER_NS, t0);
+}
+// Text //
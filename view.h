@@ -0,0 +1,186 @@
+#ifndef VIEW_H_
+#define VIEW_H_
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRANSPARENT_PIXEL '\0'
+// Atributo no bit alto do cell: o caracter continua nos 7 bits de baixo
+// (os cells sao ASCII imprimivel) e o cell sai em video reverso
+#define CELL_HIGHLIGHT 0x80
+#define CELL_CHAR(c) ((char)((c) & 0x7f))
+
+// __b__ (char *) precisa estar declarado no escopo de quem usa
+#define printf_to_view(vw, x, y, sz, fmt, ...)      \
+    do{                                             \
+        __b__ = malloc(sizeof(char) * (sz));  \
+        if (__b__ == NULL)                          \
+            break;                                  \
+        snprintf(__b__, (sz), fmt, __VA_ARGS__);    \
+        print_to_view((vw), (x), (y), (sz), __b__); \
+        free(__b__);                                \
+    }while(0);                                      
+#define POSTYPE struct {int x, y, width, height;}
+
+// Retangulo solto, usado para damage e geometria
+struct Rect {
+    POSTYPE;
+};
+
+#define VIEW_DENSE 0     // buffer com width * height chars
+#define VIEW_ROWS  1     // linhas compartilhadas com copy-on-write
+
+// Linha do modo VIEW_ROWS, pode estar em varios y ao mesmo tempo
+struct Row {
+    int refs;
+    char *cells;
+};
+
+struct RowStore {
+    int width;
+    struct Row **rows;          // uma por y
+    struct Row *fills[256];     // linhas uniformes, uma por caracter
+};
+
+struct BaseView {
+    POSTYPE;
+    char *buffer;           // VIEW_DENSE, linha y comeca em buffer + y * stride
+    int stride;
+    int mode;
+    struct RowStore *store; // VIEW_ROWS
+    // subview: retangulo de parent (dono da memoria), off_x/off_y absolutos
+    struct BaseView *parent;
+    int off_x, off_y;
+    // retangulo do view passado em create_subview (offsets absolutos)
+    int base_x, base_y, base_w, base_h;
+};
+
+struct TextView {
+    POSTYPE;
+    char *text;
+    enum {
+        CENTER,
+        LEFT
+    } alignment;
+    enum {
+        YES,
+        NO
+    } wraping;
+    char bg;
+    int length;
+};
+
+// Utils //
+void clamp_int(int *x, int min, int max);
+
+int in_range(int x, int a, int b);
+
+int is_printable_char(char c);
+// Utils //
+
+// View //
+void fill_view(struct BaseView *vw, char c);
+
+// Preenche so o retangulo r (limitado a vw) com c
+void fill_rect(struct BaseView *vw, const struct Rect *r, char c);
+
+struct BaseView *create_view(int width, int height, int x, int y);
+
+// View com linhas compartilhadas: linhas em branco ou uniformes apontam
+// para uma unica linha e linhas iguais podem ser juntadas (compact_view).
+// Toda funcao de view funciona nos dois modos.
+struct BaseView *create_rows_view(int width, int height, int x, int y);
+
+// Subview: janela de width x height em parent comecando em (off_x, off_y),
+// sem copiar nem alocar celulas. Leitura e escrita vao direto para parent.
+// parent precisa viver mais que a subview.
+// retorna NULL se o retangulo (offsets e tamanho) nao couber em parent
+struct BaseView *create_subview(struct BaseView *parent, int off_x, int off_y,
+                                int width, int height);
+
+// Move a janela da subview, O(1). Os offsets sao relativos ao parent do
+// create_subview e sao limitados para o retangulo ficar dentro dele.
+void move_subview(struct BaseView *vw, int off_x, int off_y);
+
+struct BaseView *destroy_view(struct BaseView *vw);
+
+// Linha y para leitura, y deve estar dentro da view
+const char *view_row(struct BaseView *vw, int y);
+
+// Linha y para escrita, copia a linha se ela for compartilhada
+// retorna NULL se nao conseguir alocar
+char *view_row_mut(struct BaseView *vw, int y);
+
+// Junta linhas iguais (VIEW_ROWS)
+// retorna quantas linhas foram liberadas, -1 se tiver erro
+int compact_view(struct BaseView *vw);
+
+// Memoria usada pela view em bytes (aproximado)
+size_t view_memory(struct BaseView *vw);
+
+// return 1 se conseguir setar o valor
+int set_value(struct BaseView *vw, int x, int y, char value);
+
+// Liga o CELL_HIGHLIGHT de n cells a partir de (x, y) sem mudar o texto
+// retorna quantos cells foram marcados
+int highlight_cells(struct BaseView *vw, int x, int y, int n);
+
+// Joga o buffer de vw em vw2->buffer
+// retorna -1 se tiver erro
+int render_vw_to_view(struct BaseView *vw, struct BaseView *vw2);
+
+// Imprime um texto no buffer de vw
+// retorna -1 se algo der errado, caso contratio quantos valores foram impressos
+int print_to_view(struct BaseView *vw, int x_off, int y_off,
+                           int txt_sz, char *txt);
+
+void render_view(struct BaseView *vw);
+
+// Diferenca maxima entre dois cells alterados para que sejam
+// enviados no mesmo trecho, sem mover o cursor
+#define DIFF_GAP 4
+
+// Buffer de saida que cresce conforme precisa
+struct OutBuf {
+    char *data;
+    size_t len, cap;
+};
+
+// retorna -1 se nao conseguir alocar
+int outbuf_append(struct OutBuf *ob, const char *s, size_t n);
+
+void outbuf_free(struct OutBuf *ob);
+
+// Escreve n cells em ob na posicao do cursor; CELL_HIGHLIGHT vira as
+// sequencias de video reverso, desligado de novo no fim
+// retorna -1 se nao conseguir alocar
+int outbuf_append_cells(struct OutBuf *ob, const char *cells, int n);
+
+// Escreve em ob as sequencias para a tela que mostra front passar a mostrar
+// back, front fica igual a back. Compara apenas a area em comum.
+// retorna quantos cells mudaram, -1 se tiver erro
+int diff_view(struct BaseView *front, struct BaseView *back, struct OutBuf *ob);
+
+// diff_view so dentro dos retangulos (coordenadas da view), o resto do
+// front fica como esta
+// retorna quantos cells mudaram, -1 se tiver erro
+int diff_view_rects(struct BaseView *front, struct BaseView *back,
+                    const struct Rect *rects, int nrects, struct OutBuf *ob);
+
+// Desenha as estatisticas do trace no canto superior direito de vw
+// Cada linha mostra o valor do ultimo frame e o total
+// retorna o retangulo desenhado
+struct Rect render_trace_overlay(struct BaseView *vw);
+// View //
+
+// Text //
+struct TextView *create_text(int width, int height, int x, int y);
+
+// TODO: melhor forma de retornar
+char *load_text(struct TextView *txt, const char *text);
+
+struct TextView *destroi_text(struct TextView *txt);
+
+// TODO: melhor forma de retornar
+void render_text_to_view(struct TextView *txt, struct BaseView *v);
+// Text //
+#endif